@@ -0,0 +1,136 @@
+/**
+ * @file AsyncImageLoader.h
+ * @brief This file defines the AsyncImageLoader class, a worker pool that decodes images off the UI thread.
+ *
+ * Decode requests return a std::shared_future that the UI polls while it keeps handling key presses.
+ * Requests that are still queued when the user moves on can be cancelled, their futures then hold
+ * an empty result. Components sharing a loader tag their requests with an owner, so that one of
+ * them can cancel its own requests without dropping the others.
+ */
+
+#ifndef ASYNCIMAGELOADER_H
+#define ASYNCIMAGELOADER_H
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class AsyncImageLoader
+ * @brief A pool of worker threads running decode jobs in submission order.
+ */
+class AsyncImageLoader {
+public:
+    /**
+     * @brief Constructor for the AsyncImageLoader class. Starts the worker threads.
+     * @param numThreads The number of worker threads. Uses all cores if zero.
+     */
+    explicit AsyncImageLoader(unsigned int numThreads = 0);
+
+    /**
+     * @brief Destructor for the AsyncImageLoader class. Cancels the queued jobs and stops the workers.
+     */
+    ~AsyncImageLoader();
+
+    AsyncImageLoader(const AsyncImageLoader&) = delete;
+    AsyncImageLoader& operator=(const AsyncImageLoader&) = delete;
+
+    /**
+     * @brief Queues an image file for decoding.
+     * @param path The path of the image file.
+     * @param flags The cv::imread flags.
+     * @param owner The component the request belongs to, used to cancel only its requests.
+     * @return A future holding the decoded image, or an empty image if decoding failed or was cancelled.
+     */
+    std::shared_future<cv::Mat> load(const std::string& path, int flags = cv::IMREAD_COLOR, const void* owner = nullptr);
+
+    /**
+     * @brief Queues an arbitrary task on the worker threads.
+     * @param task The task to run.
+     * @param owner The component the task belongs to, used to cancel only its tasks.
+     * @return A future holding the result of the task, or a default constructed value if the task was cancelled.
+     */
+    template <typename T>
+    std::shared_future<T> submit(std::function<T()> task, const void* owner = nullptr);
+
+    /**
+     * @brief Cancels all jobs that did not start yet. Running jobs are finished.
+     */
+    void cancelPending();
+
+    /**
+     * @brief Cancels the jobs of one owner that did not start yet. Running jobs are finished.
+     * @param owner The owner passed to load() or submit().
+     */
+    void cancelPending(const void* owner);
+
+    /**
+     * @brief Checks whether a future holds its result.
+     * @param future The future to check.
+     * @return True if the result is available without blocking.
+     */
+    template <typename T>
+    static bool isReady(const std::shared_future<T>& future);
+
+private:
+    /**
+     * @brief A queued job with the callbacks to run or cancel it.
+     */
+    struct Job {
+        std::function<void()> run; ///< Runs the job and fulfills its promise.
+        std::function<void()> cancel; ///< Fulfills the promise with an empty result.
+        const void* owner = nullptr; ///< Component the job belongs to.
+    };
+
+    std::vector<std::thread> workers; ///< Worker threads.
+    std::deque<Job> jobs; ///< Jobs waiting for a worker.
+    std::mutex jobsMutex; ///< Guards the job queue.
+    std::condition_variable jobsCondition; ///< Wakes up the workers.
+    bool stopping = false; ///< Flag to stop the workers.
+
+    /**
+     * @brief Adds a job to the queue.
+     * @param job The job to add.
+     */
+    void enqueue(Job job);
+
+    /**
+     * @brief Main loop of the worker threads.
+     */
+    void workerLoop();
+};
+
+template <typename T>
+std::shared_future<T> AsyncImageLoader::submit(std::function<T()> task, const void* owner) {
+    auto promise = std::make_shared<std::promise<T>>();
+    std::shared_future<T> future = promise->get_future().share();
+
+    Job job;
+    job.run = [promise, task] {
+        try {
+            promise->set_value(task());
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    };
+    job.cancel = [promise] { promise->set_value(T()); };
+    job.owner = owner;
+    enqueue(std::move(job));
+    return future;
+}
+
+template <typename T>
+bool AsyncImageLoader::isReady(const std::shared_future<T>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+#endif // ASYNCIMAGELOADER_H
@@ -0,0 +1,107 @@
+/**
+ * @file BoundedQueue.h
+ * @brief This file defines the BoundedQueue class, a blocking queue of limited capacity connecting pipeline threads.
+ *
+ * A full queue blocks its producer, so a slow stage holds back the stages before it instead of
+ * letting items pile up in memory. Producers that must not wait, such as live sources, can use
+ * tryPush to drop items instead.
+ * Closing the queue wakes up all waiting threads; the consumer still receives the queued items.
+ */
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/**
+ * @class BoundedQueue
+ * @brief A thread-safe FIFO queue with a fixed capacity.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Constructor for the BoundedQueue class.
+     * @param capacity The maximum number of queued items.
+     */
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    /**
+     * @brief Adds an item, waiting while the queue is full.
+     * @param item The item.
+     * @return False if the queue was closed.
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Adds an item if the queue is not full.
+     * @param item The item.
+     * @return False if the queue is full or closed.
+     */
+    bool tryPush(T item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed || items.size() >= capacity) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting while the queue is empty.
+     * @param item Receives the item.
+     * @return False if the queue is closed and empty.
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Returns whether the queue was closed, which tells a failed tryPush on a full queue apart from a closed one.
+     * @return True if the queue was closed.
+     */
+    bool isClosed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return closed;
+    }
+
+    /**
+     * @brief Closes the queue. Pushing fails afterwards, popping returns the remaining items.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity; ///< Maximum number of queued items.
+    std::deque<T> items; ///< Queued items, oldest first.
+    bool closed = false; ///< Whether the queue was closed.
+    std::mutex mutex; ///< Guards the items and the closed flag.
+    std::condition_variable notFull; ///< Wakes up producers waiting for space.
+    std::condition_variable notEmpty; ///< Wakes up consumers waiting for items.
+};
+
+#endif // BOUNDEDQUEUE_H
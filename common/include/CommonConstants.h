@@ -0,0 +1,18 @@
+/**
+ * @file CommonConstants.h
+ * @brief This file contains the constants of the helpers shared by all projects.
+ *
+ * It is included by the constants.h of every project, so the constants are used as constants::name everywhere.
+ */
+
+#ifndef COMMONCONSTANTS_H
+#define COMMONCONSTANTS_H
+
+#include <cstddef>
+
+namespace constants {
+    constexpr int indexRescanInterval = 1000; // Milliseconds between directory rescans where inotify is not available
+    constexpr size_t traceCapacity = 100000; // Number of stage timings kept for the trace on every thread
+}
+
+#endif // COMMONCONSTANTS_H
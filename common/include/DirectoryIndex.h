@@ -0,0 +1,135 @@
+/**
+ * @file DirectoryIndex.h
+ * @brief This file defines the DirectoryIndex class, a sorted list of the image files of a directory that stays up to date.
+ *
+ * The DirectoryIndex scans its directory once and computes the sort key of every file once. Afterwards
+ * it is updated incrementally from inotify events on Linux, so files added to or removed from the
+ * directory show up without a rescan. On other platforms the directory is rescanned periodically.
+ */
+
+#ifndef DIRECTORYINDEX_H
+#define DIRECTORYINDEX_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class DirectoryIndex
+ * @brief A sorted, incrementally updated list of the files of a directory.
+ */
+class DirectoryIndex {
+public:
+    /**
+     * @brief Computes the sort key of a file path. Files with equal keys are ordered by path.
+     */
+    using SortKey = std::function<long long(const std::string&)>;
+
+    /**
+     * @brief Constructor for the DirectoryIndex class. Scans the directory and starts watching it.
+     * @param path The path of the directory.
+     * @param key The sort key of the files. Files are sorted by path if it is empty.
+     * @param depth The number of subdirectory levels between the directory and its files,
+     *        0 for files directly inside the directory.
+     */
+    DirectoryIndex(const std::string& path, SortKey key = nullptr, int depth = 0);
+
+    /**
+     * @brief Destructor for the DirectoryIndex class. Stops watching the directory.
+     */
+    ~DirectoryIndex();
+
+    DirectoryIndex(const DirectoryIndex&) = delete;
+    DirectoryIndex& operator=(const DirectoryIndex&) = delete;
+
+    /**
+     * @brief Returns the sorted file paths.
+     * @return The file paths.
+     */
+    const std::vector<std::string>& files() const { return paths; }
+
+    /**
+     * @brief Applies the changes of the directory since the last call. Does not block.
+     * @return True if files were added or removed.
+     */
+    bool poll();
+
+private:
+    /**
+     * @brief A file together with its precomputed sort key.
+     */
+    struct Entry {
+        long long key; ///< Sort key of the file.
+        std::string path; ///< Path of the file.
+
+        bool operator<(const Entry& other) const {
+            return key != other.key ? key < other.key : path < other.path;
+        }
+    };
+
+    std::string root; ///< Path of the directory.
+    SortKey key; ///< Sort key of the files.
+    int depth; ///< Number of subdirectory levels between the directory and its files.
+    std::vector<Entry> entries; ///< Files sorted by key and path.
+    std::vector<std::string> paths; ///< Paths of the sorted files.
+    std::chrono::steady_clock::time_point lastScan; ///< Time of the last full scan.
+    int watchFd = -1; ///< inotify file descriptor, -1 if the directory is rescanned instead.
+    std::unordered_map<int, std::pair<std::string, int>> watches; ///< Maps inotify watches to directories and their levels.
+
+    /**
+     * @brief Scans the directory and replaces all entries.
+     * @return True if the files changed.
+     */
+    bool rescan();
+
+    /**
+     * @brief Adds the files of a directory and its subdirectories to a list, and watches the directories.
+     * @param directory The path of the directory.
+     * @param level The number of subdirectory levels between the root and this directory.
+     * @param found The list the files are added to.
+     */
+    void scan(const std::string& directory, int level, std::vector<Entry>& found);
+
+    /**
+     * @brief Starts watching a directory for added and removed files.
+     * @param directory The path of the directory.
+     * @param level The number of subdirectory levels between the root and this directory.
+     */
+    void watch(const std::string& directory, int level);
+
+    /**
+     * @brief Reads the pending inotify events and applies them to the entries.
+     * @return True if the files changed.
+     */
+    bool readEvents();
+
+    /**
+     * @brief Inserts a file at its sorted position unless it is already indexed.
+     * @param path The path of the file.
+     * @return True if the file was inserted.
+     */
+    bool insert(const std::string& path);
+
+    /**
+     * @brief Removes a file, or all files below a directory.
+     * @param path The path of the file or directory.
+     * @return True if files were removed.
+     */
+    bool remove(const std::string& path);
+
+    /**
+     * @brief Computes the sort key of a file.
+     * @param path The path of the file.
+     * @return The sort key.
+     */
+    long long sortKey(const std::string& path) const;
+
+    /**
+     * @brief Rebuilds the list of paths from the entries.
+     */
+    void updatePaths();
+};
+
+#endif // DIRECTORYINDEX_H
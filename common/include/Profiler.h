@@ -0,0 +1,144 @@
+/**
+ * @file Profiler.h
+ * @brief This file defines the Profiler and ScopedTimer classes, which measure the time spent in each stage of a frame.
+ *
+ * Stages such as decoding, processing and imshow are timed with a ScopedTimer, also on worker threads.
+ * The Profiler keeps the latest duration of every stage for an on-screen overlay and a bounded history
+ * of all timings, which can be written as a Chrome trace and opened in chrome://tracing or Perfetto.
+ * Every thread records into its own buffer, so timing a stage never waits for another thread; the
+ * buffers are only merged when the overlay is drawn or the trace is written.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class Profiler
+ * @brief A thread-safe collector of stage timings shared by the whole application.
+ */
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Returns the profiler of the application.
+     * @return The profiler instance.
+     */
+    static Profiler& instance();
+
+    /**
+     * @brief Records the timing of a stage.
+     * @param stage The name of the stage.
+     * @param start The time the stage started.
+     * @param end The time the stage ended.
+     */
+    void record(const std::string& stage, Clock::time_point start, Clock::time_point end);
+
+    /**
+     * @brief Switches the on-screen overlay on or off.
+     */
+    void toggleOverlay() { overlay = !overlay; }
+
+    /**
+     * @brief Returns whether the on-screen overlay is shown.
+     * @return True if the overlay is shown.
+     */
+    bool overlayEnabled() const { return overlay; }
+
+    /**
+     * @brief Draws the latest duration of every stage onto an image.
+     * @param image The image the overlay is drawn on.
+     */
+    void drawOverlay(cv::Mat& image);
+
+    /**
+     * @brief Writes the recorded timings in the Chrome trace event format.
+     * @param path The path of the JSON file.
+     * @return True if the file was written.
+     */
+    bool writeTrace(const std::string& path);
+
+private:
+    /**
+     * @brief A timed stage of the trace.
+     */
+    struct Event {
+        std::string stage; ///< Name of the stage.
+        long long start; ///< Start time in microseconds since the profiler was created.
+        long long duration; ///< Duration in microseconds.
+        int thread; ///< Number of the thread the stage ran on.
+    };
+
+    /**
+     * @brief The latest timing of a stage on one thread.
+     */
+    struct Latest {
+        std::string stage; ///< Name of the stage.
+        long long firstStart; ///< Start of the first timing of the stage in microseconds, orders the overlay.
+        long long end; ///< End of the latest timing in microseconds.
+        double milliseconds; ///< Duration of the latest timing.
+    };
+
+    /**
+     * @brief The timings recorded by one thread.
+     */
+    struct ThreadBuffer {
+        int thread; ///< Number of the thread for the trace.
+        std::mutex mutex; ///< Guards the buffer, only contended while the overlay or the trace reads it.
+        std::deque<Event> events; ///< Recorded timings, the oldest are dropped when the capacity is reached.
+        std::vector<Latest> latest; ///< Latest timing of every stage, few stages are timed.
+    };
+
+    Clock::time_point origin; ///< Time the profiler was created, the trace starts here.
+    std::mutex buffersMutex; ///< Guards the list of buffers, taken once per thread and by the readers.
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers; ///< Buffers of all threads that recorded a timing, kept after the threads exit.
+    std::atomic<bool> overlay{false}; ///< Whether the on-screen overlay is shown.
+
+    /**
+     * @brief Returns the buffer of the calling thread, creating it on the first call.
+     * @return The buffer of the calling thread.
+     */
+    ThreadBuffer& localBuffer();
+
+    /**
+     * @brief Constructor for the Profiler class.
+     */
+    Profiler();
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Times the scope it lives in and records it in the profiler.
+ */
+class ScopedTimer {
+public:
+    /**
+     * @brief Starts timing a stage.
+     * @param stage The name of the stage, it must outlive the timer.
+     */
+    explicit ScopedTimer(const char* stage) : stage(stage), start(Profiler::Clock::now()) {}
+
+    /**
+     * @brief Stops timing and records the stage.
+     */
+    ~ScopedTimer() { Profiler::instance().record(stage, start, Profiler::Clock::now()); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* stage; ///< Name of the stage.
+    Profiler::Clock::time_point start; ///< Time the stage started.
+};
+
+#endif // PROFILER_H
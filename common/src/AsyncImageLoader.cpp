@@ -0,0 +1,86 @@
+#include <AsyncImageLoader.h>
+#include <Profiler.h>
+#include <algorithm>
+#include <iterator>
+
+using namespace cv;
+using namespace std;
+
+AsyncImageLoader::AsyncImageLoader(unsigned int numThreads) {
+    if (numThreads == 0) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&AsyncImageLoader::workerLoop, this);
+    }
+}
+
+AsyncImageLoader::~AsyncImageLoader() {
+    cancelPending();
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+shared_future<Mat> AsyncImageLoader::load(const string& path, int flags, const void* owner) {
+    return submit<Mat>([path, flags] {
+        ScopedTimer timer("decode");
+        return imread(path, flags);
+    }, owner);
+}
+
+void AsyncImageLoader::cancelPending() {
+    deque<Job> cancelled;
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        cancelled.swap(jobs);
+    }
+    // Fulfill the promises outside the lock
+    for (auto& job : cancelled) {
+        job.cancel();
+    }
+}
+
+void AsyncImageLoader::cancelPending(const void* owner) {
+    deque<Job> cancelled;
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        // Keep the order of the remaining jobs
+        auto kept = stable_partition(jobs.begin(), jobs.end(), [owner](const Job& job) { return job.owner != owner; });
+        move(kept, jobs.end(), back_inserter(cancelled));
+        jobs.erase(kept, jobs.end());
+    }
+    // Fulfill the promises outside the lock
+    for (auto& job : cancelled) {
+        job.cancel();
+    }
+}
+
+void AsyncImageLoader::enqueue(Job job) {
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobsCondition.notify_one();
+}
+
+void AsyncImageLoader::workerLoop() {
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock(jobsMutex);
+            jobsCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job.run();
+    }
+}
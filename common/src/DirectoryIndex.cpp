@@ -0,0 +1,195 @@
+#include <DirectoryIndex.h>
+#include <CommonConstants.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+DirectoryIndex::DirectoryIndex(const string& path, SortKey key, int depth) : root(path), key(std::move(key)), depth(depth) {
+    if (!filesystem::exists(root)) {
+        cerr << "ERROR: Path does not exist. Correct it in constants.h file" << endl;
+        return;
+    }
+#ifdef __linux__
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd == -1) {
+        cerr << "Cannot watch " << root << ", it is rescanned periodically instead" << endl;
+    }
+#endif
+    rescan();
+}
+
+DirectoryIndex::~DirectoryIndex() {
+#ifdef __linux__
+    // Closing the descriptor removes all watches
+    if (watchFd != -1) {
+        close(watchFd);
+    }
+#endif
+}
+
+bool DirectoryIndex::poll() {
+    if (watchFd != -1) {
+        return readEvents();
+    }
+    auto interval = chrono::milliseconds(constants::indexRescanInterval);
+    if (chrono::steady_clock::now() - lastScan < interval || !filesystem::exists(root)) {
+        return false;
+    }
+    return rescan();
+}
+
+bool DirectoryIndex::rescan() {
+    vector<Entry> found;
+    try {
+        scan(root, 0, found);
+    } catch (const filesystem::filesystem_error& e) {
+        cerr << e.what() << endl;
+    }
+    sort(found.begin(), found.end());
+    lastScan = chrono::steady_clock::now();
+
+    bool changed = found.size() != entries.size() ||
+                   !equal(found.begin(), found.end(), entries.begin(), [](const Entry& a, const Entry& b) { return a.path == b.path; });
+    entries = std::move(found);
+    if (changed) {
+        updatePaths();
+    }
+    return changed;
+}
+
+void DirectoryIndex::scan(const string& directory, int level, vector<Entry>& found) {
+    watch(directory, level);
+    for (const auto& entry : filesystem::directory_iterator(directory)) {
+        if (level < depth) {
+            if (entry.is_directory()) {
+                scan(entry.path().string(), level + 1, found);
+            }
+        } else if (entry.is_regular_file()) {
+            // Skip subdirectories such as the thumbnail store
+            string path = entry.path().string();
+            found.push_back(Entry{sortKey(path), path});
+        }
+    }
+}
+
+void DirectoryIndex::watch(const string& directory, int level) {
+#ifdef __linux__
+    if (watchFd == -1) {
+        return;
+    }
+    // Directories above the files are watched for subdirectories, the others for finished files
+    uint32_t mask = IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | (level < depth ? IN_CREATE : IN_CLOSE_WRITE);
+    int wd = inotify_add_watch(watchFd, directory.c_str(), mask);
+    if (wd != -1) {
+        watches[wd] = {directory, level};
+    }
+#endif
+}
+
+bool DirectoryIndex::readEvents() {
+    bool changed = false;
+#ifdef __linux__
+    bool overflow = false;
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        // The descriptor is non-blocking, read fails once no events are pending
+        ssize_t length = read(watchFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            auto* event = reinterpret_cast<inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            auto it = watches.find(event->wd);
+            if (it == watches.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watches.erase(it);
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+            // Copy the directory, scanning a new subdirectory adds watches
+            auto [directory, level] = it->second;
+            string path = (filesystem::path(directory) / event->name).string();
+            bool isDirectory = event->mask & IN_ISDIR;
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                changed |= remove(path);
+            } else if (isDirectory && level < depth) {
+                // A subdirectory that was moved in may already contain files
+                vector<Entry> found;
+                try {
+                    scan(path, level + 1, found);
+                } catch (const filesystem::filesystem_error& e) {
+                    cerr << e.what() << endl;
+                }
+                for (const auto& entry : found) {
+                    changed |= insert(entry.path);
+                }
+            } else if (!isDirectory && level == depth) {
+                changed |= insert(path);
+            }
+        }
+    }
+    if (overflow) {
+        // Events were lost, fall back to a full scan
+        return rescan() || changed;
+    }
+    if (changed) {
+        updatePaths();
+    }
+#endif
+    return changed;
+}
+
+bool DirectoryIndex::insert(const string& path) {
+    Entry entry{sortKey(path), path};
+    auto it = lower_bound(entries.begin(), entries.end(), entry);
+    if (it != entries.end() && it->path == path) {
+        return false;
+    }
+    entries.insert(it, entry);
+    return true;
+}
+
+bool DirectoryIndex::remove(const string& path) {
+    string prefix = (filesystem::path(path) / "").string();
+    auto removed = remove_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+        return entry.path == path || entry.path.compare(0, prefix.size(), prefix) == 0;
+    });
+    bool changed = removed != entries.end();
+    entries.erase(removed, entries.end());
+    return changed;
+}
+
+long long DirectoryIndex::sortKey(const string& path) const {
+    if (!key) {
+        return 0;
+    }
+    try {
+        return key(path);
+    } catch (const exception&) {
+        // Files without a parsable key are sorted first, by path
+        return 0;
+    }
+}
+
+void DirectoryIndex::updatePaths() {
+    paths.clear();
+    paths.reserve(entries.size());
+    for (const auto& entry : entries) {
+        paths.push_back(entry.path);
+    }
+}
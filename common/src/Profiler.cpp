@@ -0,0 +1,127 @@
+#include <Profiler.h>
+#include <CommonConstants.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+Profiler::Profiler() : origin(Clock::now()) {}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::ThreadBuffer& Profiler::localBuffer() {
+    // The profiler is a singleton, so one buffer per thread is enough
+    thread_local shared_ptr<ThreadBuffer> local;
+    if (!local) {
+        local = make_shared<ThreadBuffer>();
+        lock_guard<mutex> lock(buffersMutex);
+        local->thread = int(buffers.size()) + 1;
+        buffers.push_back(local);
+    }
+    return *local;
+}
+
+void Profiler::record(const string& stage, Clock::time_point start, Clock::time_point end) {
+    long long startUs = chrono::duration_cast<chrono::microseconds>(start - origin).count();
+    long long endUs = chrono::duration_cast<chrono::microseconds>(end - origin).count();
+
+    ThreadBuffer& buffer = localBuffer();
+    lock_guard<mutex> lock(buffer.mutex);
+    buffer.events.push_back(Event{stage, startUs, endUs - startUs, buffer.thread});
+    if (buffer.events.size() > constants::traceCapacity) {
+        buffer.events.pop_front();
+    }
+
+    // Few stages are timed, so a linear search is enough
+    auto it = find_if(buffer.latest.begin(), buffer.latest.end(), [&stage](const Latest& entry) { return entry.stage == stage; });
+    if (it == buffer.latest.end()) {
+        buffer.latest.push_back(Latest{stage, startUs, endUs, (endUs - startUs) / 1000.0});
+    } else {
+        it->end = endUs;
+        it->milliseconds = (endUs - startUs) / 1000.0;
+    }
+}
+
+void Profiler::drawOverlay(Mat& image) {
+    // Merge the threads: the most recent timing of every stage, in order of first appearance
+    vector<Latest> merged;
+    {
+        lock_guard<mutex> lock(buffersMutex);
+        for (const auto& buffer : buffers) {
+            lock_guard<mutex> bufferLock(buffer->mutex);
+            for (const Latest& entry : buffer->latest) {
+                auto it = find_if(merged.begin(), merged.end(), [&entry](const Latest& other) { return other.stage == entry.stage; });
+                if (it == merged.end()) {
+                    merged.push_back(entry);
+                    continue;
+                }
+                it->firstStart = min(it->firstStart, entry.firstStart);
+                if (entry.end > it->end) {
+                    it->end = entry.end;
+                    it->milliseconds = entry.milliseconds;
+                }
+            }
+        }
+    }
+    stable_sort(merged.begin(), merged.end(), [](const Latest& a, const Latest& b) { return a.firstStart < b.firstStart; });
+    vector<string> lines;
+    for (const Latest& entry : merged) {
+        char line[128];
+        snprintf(line, sizeof(line), "%s: %.1f ms", entry.stage.c_str(), entry.milliseconds);
+        lines.push_back(line);
+    }
+    if (lines.empty()) {
+        return;
+    }
+
+    // Darken the background of the text so that it is readable on any image
+    int lineHeight = 20;
+    Rect box = Rect(0, 0, 260, lineHeight * int(lines.size()) + 10) & Rect(0, 0, image.cols, image.rows);
+    Mat background = image(box);
+    background.convertTo(background, -1, 0.3);
+    for (size_t i = 0; i < lines.size(); i++) {
+        putText(image, lines[i], Point(8, lineHeight * int(i + 1)), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 1);
+    }
+}
+
+bool Profiler::writeTrace(const string& path) {
+    ofstream output(path);
+    if (!output) {
+        cerr << "Failed to write trace: " << path << endl;
+        return false;
+    }
+    vector<Event> events;
+    {
+        lock_guard<mutex> lock(buffersMutex);
+        for (const auto& buffer : buffers) {
+            lock_guard<mutex> bufferLock(buffer->mutex);
+            events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+        }
+    }
+    sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+    // Complete events ("ph": "X") with times in microseconds
+    output << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& event = events[i];
+        string name;
+        for (char c : event.stage) {
+            if (c == '"' || c == '\\') name += '\\';
+            name += c;
+        }
+        output << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+               << ",\"pid\":1,\"tid\":" << event.thread << "}" << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    output << "],\"displayTimeUnit\":\"ms\"}\n";
+    if (!output) {
+        cerr << "Failed to write trace: " << path << endl;
+        return false;
+    }
+    cout << "Wrote " << events.size() << " timings to " << path << endl;
+    return true;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file BatchProcessor.h
+ * @brief This file defines the BatchProcessor class, which runs the ImageViewer crop and rotate operations headless.
+ *
+ * The BatchProcessor reads a list of (image, ROI) jobs and writes the crops and their 180 degree
+ * rotations to an output directory. Images are processed in parallel on all cores, so the same
+ * transforms can be applied to whole datasets on machines without a display.
+ */
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @struct CropJob
+ * @brief A region of interest to crop from an image.
+ */
+struct CropJob {
+    std::string image; ///< Path of the image file.
+    cv::Point center; ///< Center of the region of interest.
+    int width; ///< Width of the region of interest.
+    int height; ///< Height of the region of interest.
+    int line; ///< Line of the job in the job list, used to name the outputs.
+};
+
+/**
+ * @class BatchProcessor
+ * @brief A class to crop and rotate regions of many images in parallel.
+ */
+class BatchProcessor {
+public:
+    /**
+     * @brief Reads a job list. Each line holds "image,x,y" or "image,x,y,width,height".
+     *        Empty lines and lines starting with '#' are skipped.
+     * @param jobsPath The path of the job list.
+     * @return True if the job list could be read.
+     */
+    bool loadJobs(const std::string& jobsPath);
+
+    /**
+     * @brief Runs all jobs and prints the throughput.
+     * @param outputPath The directory where the crops and rotations are written.
+     * @param numThreads The number of worker threads. Uses all cores if zero.
+     * @return The number of failed jobs. All jobs fail, and at least 1 is returned, if the output directory
+     * cannot be created.
+     */
+    int run(const std::string& outputPath, unsigned int numThreads = 0);
+
+private:
+    std::vector<CropJob> jobs; ///< Jobs sorted by image, so that every image is decoded once.
+
+    /**
+     * @brief Decodes one image and runs all of its jobs.
+     * @param first Index of the first job of the image.
+     * @param last Index past the last job of the image.
+     * @param outputPath The directory where the crops and rotations are written.
+     * @return The number of failed jobs.
+     */
+    int processImage(size_t first, size_t last, const std::string& outputPath);
+
+    /**
+     * @brief Crops a rectangular region from an image.
+     * @param img The source image.
+     * @param center The center point of the rectangle.
+     * @param width The width of the rectangle.
+     * @param height The height of the rectangle.
+     * @return A cv::Mat header of the region, sharing the pixels of the image.
+     */
+    static cv::Mat cropRectangle(const cv::Mat &img, const cv::Point &center, int width, int height);
+};
+
+#endif // BATCHPROCESSOR_H
@@ -0,0 +1,109 @@
+/**
+ * @file ContactSheet.h
+ * @brief This file defines the ContactSheet class, a scrollable thumbnail grid of a whole image directory.
+ *
+ * The ContactSheet is virtualized: only the tiles of the visible rows are decoded and composited.
+ * Decoded tiles are kept in a bounded LRU cache, so memory stays constant however many images
+ * the directory contains.
+ */
+
+#ifndef CONTACTSHEET_H
+#define CONTACTSHEET_H
+
+#include <opencv2/opencv.hpp>
+#include <future>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <AsyncImageLoader.h>
+#include <ThumbnailStore.h>
+
+/**
+ * @class ContactSheet
+ * @brief A virtualized grid of thumbnails with a bounded tile cache.
+ */
+class ContactSheet {
+public:
+    /**
+     * @brief Constructor for the ContactSheet class.
+     * @param thumbnails The thumbnail store providing the tiles.
+     * @param loader The loader running the tile decode jobs.
+     */
+    ContactSheet(ThumbnailStore& thumbnails, AsyncImageLoader& loader);
+
+    /**
+     * @brief Sets the images shown in the contact sheet.
+     * @param files The paths of the image files.
+     */
+    void setFiles(const std::vector<std::string>& files);
+
+    /**
+     * @brief Renders the visible rows and queues the missing tiles for decoding.
+     * @param canvas The image the contact sheet is drawn on.
+     */
+    void render(cv::Mat& canvas);
+
+    /**
+     * @brief Moves the tiles that finished decoding into the tile cache.
+     * @return True if a tile arrived and the contact sheet should be rendered again.
+     */
+    bool update();
+
+    /**
+     * @brief Scrolls the contact sheet and cancels the decode jobs of tiles that left the view.
+     * @param rows The number of rows to scroll, negative values scroll up.
+     */
+    void scroll(int rows);
+
+    /**
+     * @brief Finds the image under a point of the canvas.
+     * @param point The point in canvas coordinates.
+     * @return The index of the image in the file list, or -1 if there is no image under the point.
+     */
+    int hitTest(const cv::Point& point) const;
+
+private:
+    using Tile = std::pair<std::string, cv::Mat>;
+
+    ThumbnailStore& thumbnails; ///< Thumbnail store providing the tiles.
+    AsyncImageLoader& loader; ///< Loader running the tile decode jobs.
+    std::vector<std::string> files; ///< List of image file paths.
+    int firstRow = 0; ///< Index of the first visible row.
+    int columns = 1; ///< Number of tiles per row.
+    int visibleRows = 1; ///< Number of rows that fit into the canvas.
+
+    std::list<Tile> tiles; ///< Cached tiles, most recently used first.
+    std::unordered_map<std::string, std::list<Tile>::iterator> tileIndex; ///< Maps file paths to cached tiles.
+    std::unordered_map<std::string, std::shared_future<cv::Mat>> inFlight; ///< Tile decode jobs that did not finish yet.
+
+    /**
+     * @brief Returns the size of a grid cell including its margin.
+     * @return The size of a square grid cell in pixels.
+     */
+    static int cellSize();
+
+    /**
+     * @brief Looks up a tile and marks it as most recently used.
+     * @param path The path of the image file.
+     * @param tile The cached tile if found.
+     * @return True if the tile is cached.
+     */
+    bool lookup(const std::string& path, cv::Mat& tile);
+
+    /**
+     * @brief Queues a decode job for a tile unless it is already queued.
+     * @param path The path of the image file.
+     */
+    void request(const std::string& path);
+
+    /**
+     * @brief Decodes the tile of an image, from the thumbnail store when possible.
+     * @param thumbnails The thumbnail store.
+     * @param path The path of the image file.
+     * @return The tile, never empty.
+     */
+    static cv::Mat decodeTile(ThumbnailStore& thumbnails, const std::string& path);
+};
+
+#endif // CONTACTSHEET_H
@@ -0,0 +1,124 @@
+/**
+ * @file ImageCache.h
+ * @brief This file defines the ImageCache class, a memory-budgeted LRU cache of decoded and rotated frames.
+ *
+ * The ImageCache keeps the most recently used frames in memory together with their rotated versions,
+ * so that switching back to an already seen image does not decode the JPEG again. Missing frames
+ * are decoded on the worker threads of an AsyncImageLoader, which also prefetches the neighbouring
+ * images while the current one is on screen.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <AsyncImageLoader.h>
+
+/**
+ * @struct CachedFrame
+ * @brief A decoded image together with its 180 degree rotated version.
+ */
+struct CachedFrame {
+    cv::Mat image; ///< Decoded image.
+    cv::Mat rotated; ///< Image rotated by 180 degrees.
+};
+
+/**
+ * @class ImageCache
+ * @brief A bounded LRU cache of decoded frames with asynchronous decoding.
+ *
+ * Frames are keyed by their file path and the decode flags, so a frame decoded at a reduced
+ * resolution is never returned for a full resolution request or the other way around. When the total size of the cached frames exceeds the
+ * memory budget, the least recently used frames are evicted.
+ */
+class ImageCache {
+public:
+    /**
+     * @brief Constructor for the ImageCache class.
+     * @param budgetBytes The maximum number of bytes the cached frames may occupy.
+     * @param loader The loader running the decode jobs. It must stop its workers before the cache is destroyed.
+     */
+    ImageCache(size_t budgetBytes, AsyncImageLoader& loader);
+
+    ImageCache(const ImageCache&) = delete;
+    ImageCache& operator=(const ImageCache&) = delete;
+
+    /**
+     * @brief Returns the frame for a file, queueing a decode job if it is not cached yet.
+     * @param path The path of the image file.
+     * @return A future holding the frame. The images are empty if the file could not be decoded
+     *         or the decode job was cancelled.
+     */
+    std::shared_future<CachedFrame> request(const std::string& path);
+
+    /**
+     * @brief Sets the cv::imread flags used for decoding, e.g. to decode at a reduced resolution.
+     * @param flags The cv::imread flags, used by the requests made afterwards.
+     */
+    void setDecodeFlags(int flags);
+
+    /**
+     * @brief Queues decode jobs for frames that are likely to be requested soon.
+     * @param paths The paths of the image files to decode in the background.
+     */
+    void prefetch(const std::vector<std::string>& paths);
+
+private:
+    using Entry = std::pair<std::string, CachedFrame>;
+
+    size_t budgetBytes; ///< Memory budget of the cache.
+    size_t usedBytes = 0; ///< Memory used by the cached frames.
+    std::list<Entry> entries; ///< Cached frames, most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> index; ///< Maps cache keys to cache entries.
+
+    std::mutex cacheMutex; ///< Guards the cache and the in-flight jobs.
+    std::unordered_map<std::string, std::shared_future<CachedFrame>> inFlight; ///< Decode jobs that did not finish yet, by cache key.
+    AsyncImageLoader& loader; ///< Loader running the decode jobs.
+    int decodeFlags = cv::IMREAD_COLOR; ///< Flags passed to cv::imread.
+
+    /**
+     * @brief Decodes an image and computes its rotated version.
+     * @param path The path of the image file.
+     * @param flags The cv::imread flags.
+     * @return The decoded frame.
+     */
+    static CachedFrame decode(const std::string& path, int flags);
+
+    /**
+     * @brief Builds the cache key of a frame.
+     * @param path The path of the image file.
+     * @param flags The cv::imread flags the frame is decoded with.
+     * @return The key.
+     */
+    static std::string cacheKey(const std::string& path, int flags);
+
+    /**
+     * @brief Looks up a frame and marks it as most recently used. The cache mutex must be held.
+     * @param key The cache key of the frame.
+     * @param frame The cached frame if found.
+     * @return True if the frame is cached.
+     */
+    bool lookup(const std::string& key, CachedFrame& frame);
+
+    /**
+     * @brief Inserts a frame and evicts old frames to stay within the budget. The cache mutex must be held.
+     * @param key The cache key of the frame.
+     * @param frame The frame to insert.
+     */
+    void insert(const std::string& key, const CachedFrame& frame);
+
+    /**
+     * @brief Computes the memory used by a frame.
+     * @param frame The frame.
+     * @return The number of bytes used by the frame.
+     */
+    static size_t frameBytes(const CachedFrame& frame);
+};
+
+#endif // IMAGECACHE_H
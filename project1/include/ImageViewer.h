@@ -14,6 +14,14 @@
 #include <string>
 #include <vector>
 #include <constants.h>
+#include <ImageCache.h>
+#include <AsyncImageLoader.h>
+#include <DirectoryIndex.h>
+#include <ThumbnailStore.h>
+#include <ContactSheet.h>
+#include <TiledImage.h>
+#include <Profiler.h>
+#include <memory>
 
 /**
  * @class ImageViewer
@@ -46,14 +54,34 @@ private:
     static constexpr int height = constants::height; ///< Height of the display window.
     int selectedImage = -1; ///< Index of the currently selected image.
     std::vector<std::string> files; ///< List of image file paths.
+    std::unique_ptr<DirectoryIndex> directory; ///< Live index of the data directory.
 
-    cv::Mat img; ///< Original image.
     cv::Mat rotatedImg; ///< Rotated version of the original image.
-    cv::Mat displayImage; ///< Resized image for display.
+    cv::Mat displayImage; ///< Image decoded at display resolution.
+    cv::Mat cropBuffer; ///< Scratch buffer for the full resolution pixels of a crop, reused between clicks.
+    std::shared_ptr<TiledImage> tiledImage; ///< Full resolution tiles of the shown image used for cropping.
+    int shownImage = -1; ///< Number of the image shown in the grid, -1 if none.
+    int displayScale = 1; ///< Factor by which the frames are reduced for display.
     cv::Mat grid; ///< Grid to display the images.
+    cv::Mat overlayBuffer; ///< Copy of the grid with the timing overlay drawn on it.
+    Profiler::Clock::time_point requestTime; ///< Time the shown image was requested, for the display latency.
     int N1, N2; ///< Dimensions of the image grid.
     cv::Point point1, point2; ///< Points for defining a Region of Interest (ROI).
     std::string path; ///< Path to the directory containing images.
+    ImageCache cache; ///< Cache of decoded and rotated frames.
+    std::unique_ptr<ThumbnailStore> thumbnails; ///< Thumbnail pyramid of the data directory.
+    std::unique_ptr<ContactSheet> contactSheet; ///< Thumbnail grid of the whole directory.
+    bool contactSheetMode = false; ///< Flag to indicate that the contact sheet is shown instead of the images.
+    bool detailMode = false; ///< Flag to indicate that the images are shown at full resolution.
+    cv::Point viewport; ///< Top left corner of the full resolution view, in the coordinates of each image.
+    AsyncImageLoader loader; ///< Worker pool decoding the frames. Declared after the cache so that it stops first.
+    std::shared_future<CachedFrame> pendingFrame; ///< Frame being decoded for display.
+    int pendingImage = -1; ///< Number of the image being decoded for display, -1 if none.
+    std::shared_future<std::shared_ptr<TiledImage>> pendingTiles; ///< Tiles of the shown image being opened or built.
+    std::string pendingTilesPath; ///< Image file of the pending tiles.
+    bool pendingDetail = false; ///< Whether the full resolution view opens once the pending tiles are ready.
+    int pendingCrop = -1; ///< Grid cell of the crop shown once the pending tiles are ready, -1 if none.
+    cv::Point pendingCropPoint; ///< Center of the pending crop in the coordinates of its source cell.
 
     /**
      * @brief Displays images in a grid format.
@@ -61,6 +89,56 @@ private:
      */
     void displayImages(int num);
 
+    /**
+     * @brief Shows the pending frame in the grid once it is decoded.
+     */
+    void showPendingFrame();
+
+    /**
+     * @brief Takes over the tiles once they are opened and shows the crop or the full resolution view waiting for them.
+     */
+    void showPendingTiles();
+
+    /**
+     * @brief Shows the grid in the window, with the timing overlay if it is enabled.
+     */
+    void showGrid();
+
+    /**
+     * @brief Draws a placeholder into a grid cell while its image is being decoded.
+     * @param grid The grid where the placeholder will be drawn.
+     * @param position The position in the grid where the placeholder will be drawn.
+     */
+    void drawPlaceholder(cv::Mat &grid, int position);
+
+    /**
+     * @brief Switches between the contact sheet and the image grid.
+     */
+    void toggleContactSheet();
+
+    /**
+     * @brief Renders the contact sheet into the grid and shows it.
+     */
+    void showContactSheet();
+
+    /**
+     * @brief Switches between the reduced frames and the full resolution view of the shown image.
+     */
+    void toggleDetail();
+
+    /**
+     * @brief Moves the full resolution view and shows it.
+     * @param dx The horizontal movement in pixels.
+     * @param dy The vertical movement in pixels.
+     */
+    void panDetail(int dx, int dy);
+
+    /**
+     * @brief Waits for a key press while showing the frames that finish decoding.
+     * @return The pressed key.
+     */
+    char waitForKey();
+
     /**
      * @brief Creates a welcome screen with messages.
      * @param messages The messages to display on the welcome screen.
@@ -99,6 +177,61 @@ private:
      */
     cv::Mat cropRectangle(const cv::Mat &img, const cv::Point &center, int width, int height);
 
+    /**
+     * @brief Crops the full resolution image around a point and shows the crop in the grid. If the tiles
+     * are still being built, a placeholder is shown and the crop follows once they are ready.
+     * @param cellPoint The center point of the crop in the coordinates of the grid cell.
+     * @param rotated Whether to crop from the 180 degree rotated image.
+     */
+    void showCrop(const cv::Point &cellPoint, bool rotated);
+
+    /**
+     * @brief Crops a rectangular region from the full resolution version of the shown image.
+     * @param cellPoint The center point of the rectangle in the coordinates of the grid cell.
+     * @param rotated Whether to crop from the 180 degree rotated image.
+     * @param cropped The cropped pixels. Reused if it already has the size of the crop.
+     * @return False if nothing could be cropped.
+     */
+    bool cropSource(const cv::Point &cellPoint, bool rotated, cv::Mat &cropped);
+
+    /**
+     * @brief Reads a region of the full resolution image or of its 180 degree rotation.
+     * @param source The tiles of the full resolution image.
+     * @param region The region in the coordinates of the image or of the rotated image.
+     * @param rotated Whether to read from the 180 degree rotated image.
+     * @param pixels The pixels of the region. Reused if it already has the size of the clipped region.
+     * @return False if the region is outside of the image.
+     */
+    static bool readRegion(TiledImage &source, const cv::Rect &region, bool rotated, cv::Mat &pixels);
+
+    /**
+     * @brief Returns the tiles of the shown image, and starts opening them in the background if they are not open yet.
+     * Opening may decode the full image and write its tiles, which would block the key loop.
+     * @return The tiles of the shown image, or nullptr while they are opened.
+     */
+    TiledImage* openTiledImage();
+
+    /**
+     * @brief Chooses the factor by which frames are reduced so that they fit into a grid cell.
+     * @param size The full resolution size of the frames.
+     * @return The reduction factor, one of 1, 2, 4 or 8.
+     */
+    int chooseDisplayScale(const cv::Size &size);
+
+    /**
+     * @brief Converts a reduction factor to the matching cv::imread flag.
+     * @param scale The reduction factor.
+     * @return The cv::imread flag decoding straight to the reduced size.
+     */
+    static int reducedColorFlag(int scale);
+
+    /**
+     * @brief Returns a grid cell as a view of the grid, so that it can be drawn into without a copy.
+     * @param position The position of the cell in the grid.
+     * @return The view of the grid cell.
+     */
+    cv::Mat gridCell(int position);
+
     /**
      * @brief Fills a grid cell with an image.
      * @param grid The grid where the image will be placed.
@@ -108,11 +241,9 @@ private:
     void fillGrid(cv::Mat &grid, const cv::Mat &img, int position);
 
     /**
-     * @brief Retrieves the list of files from a specified directory.
-     * @param path The path to the directory.
-     * @return A vector of strings containing the file paths.
+     * @brief Applies the files added to or removed from the data directory to the file list.
      */
-    std::vector<std::string> getFiles(const std::string &path);
+    void refreshFiles();
 };
 
 #endif // IMAGEVIEWER_H
@@ -0,0 +1,127 @@
+/**
+ * @file ThumbnailStore.h
+ * @brief This file defines the ThumbnailStore class, a persistent thumbnail pyramid stored next to the images.
+ *
+ * The ThumbnailStore keeps a sidecar directory inside the data directory with a few downscaled
+ * versions of every image and an index of the source file sizes and modification times.
+ * Thumbnails are built once in parallel and rebuilt only when their source file changes.
+ */
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <AsyncImageLoader.h>
+
+/**
+ * @class ThumbnailStore
+ * @brief A sidecar store of thumbnail pyramids for the images of one directory.
+ *
+ * Level 0 is the largest thumbnail, every following level is smaller. The sizes of the levels
+ * are defined in constants.h.
+ */
+class ThumbnailStore {
+public:
+    /**
+     * @brief Constructor for the ThumbnailStore class. Reads the index of the sidecar directory.
+     * @param directory The data directory containing the images.
+     */
+    explicit ThumbnailStore(const std::string& directory);
+
+    /**
+     * @brief Destructor for the ThumbnailStore class. Stops the builders and writes the index.
+     */
+    ~ThumbnailStore();
+
+    ThumbnailStore(const ThumbnailStore&) = delete;
+    ThumbnailStore& operator=(const ThumbnailStore&) = delete;
+
+    /**
+     * @brief Builds the missing or outdated thumbnails in the background. Files whose build is
+     * already queued or running are skipped.
+     * @param files The paths of the image files.
+     */
+    void build(const std::vector<std::string>& files);
+
+    /**
+     * @brief Loads a thumbnail of an image.
+     * @param file The path of the image file.
+     * @param level The pyramid level, 0 is the largest thumbnail.
+     * @return The thumbnail, or an empty image if it is not built or outdated.
+     */
+    cv::Mat load(const std::string& file, int level);
+
+    /**
+     * @brief Returns the number of pyramid levels.
+     * @return The number of pyramid levels.
+     */
+    static int levels();
+
+private:
+    /**
+     * @brief Size and modification time of a source image when its thumbnails were built.
+     */
+    struct IndexEntry {
+        std::uintmax_t size; ///< File size in bytes.
+        long long mtime; ///< Modification time in file clock ticks.
+    };
+
+    std::string storePath; ///< Path of the sidecar directory.
+    bool enabled = true; ///< False if the sidecar directory cannot be created.
+    std::unordered_map<std::string, IndexEntry> index; ///< Maps file names to their index entries.
+    std::mutex indexMutex; ///< Guards the index.
+    std::unordered_set<std::string> pending; ///< File names with a queued or running build job.
+    bool indexChanged = false; ///< Whether the index has to be written.
+    std::unique_ptr<AsyncImageLoader> builders; ///< Small worker pool building the thumbnails next to the viewer's decoders.
+
+    /**
+     * @brief Builds the thumbnail pyramid of one image.
+     * @param file The path of the image file.
+     * @param entry The size and modification time of the image file.
+     * @return True if the thumbnails were written.
+     */
+    bool buildEntry(const std::string& file, const IndexEntry& entry);
+
+    /**
+     * @brief Reads the size and modification time of a file.
+     * @param file The path of the file.
+     * @param entry The size and modification time of the file.
+     * @return True if the file could be read.
+     */
+    static bool statFile(const std::string& file, IndexEntry& entry);
+
+    /**
+     * @brief Checks whether the thumbnails of a file are up to date. The index mutex must be held.
+     * @param file The path of the image file.
+     * @param entry The current size and modification time of the image file.
+     * @return True if the thumbnails are up to date.
+     */
+    bool isFresh(const std::string& file, const IndexEntry& entry) const;
+
+    /**
+     * @brief Returns the path of a thumbnail in the sidecar directory.
+     * @param file The path of the image file.
+     * @param level The pyramid level.
+     * @return The path of the thumbnail.
+     */
+    std::string thumbnailPath(const std::string& file, int level) const;
+
+    /**
+     * @brief Reads the index file of the sidecar directory.
+     */
+    void readIndex();
+
+    /**
+     * @brief Writes the index file of the sidecar directory. The index mutex must be held.
+     */
+    void writeIndex();
+};
+
+#endif // THUMBNAILSTORE_H
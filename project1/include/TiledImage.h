@@ -0,0 +1,115 @@
+/**
+ * @file TiledImage.h
+ * @brief This file defines the TiledImage class, which gives region access to images larger than memory.
+ *
+ * The TiledImage splits a full resolution image into fixed size lossless tiles stored in a cache
+ * directory in the system temporary directory, so the data directory stays untouched. Regions are
+ * composed from the tiles covering them, and decoded tiles are kept in a cache bounded by a memory
+ * budget, so cropping and panning never hold the full image. The tiles on disk are bounded by a size
+ * budget, the images used least recently are removed first.
+ */
+
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @class TiledImage
+ * @brief A full resolution image read tile by tile from a tile cache directory.
+ */
+class TiledImage {
+public:
+    /**
+     * @brief Constructor for the TiledImage class.
+     * @param imagePath The path of the image file.
+     * @param budgetBytes The memory budget of the tile cache in bytes.
+     */
+    TiledImage(const std::string& imagePath, size_t budgetBytes);
+
+    /**
+     * @brief Opens the tiles of the image, and splits the image into tiles if they are missing or outdated.
+     * @return True if the tiles can be read.
+     */
+    bool open();
+
+    /**
+     * @brief Returns the path of the image file.
+     * @return The path of the image file.
+     */
+    const std::string& path() const { return imagePath; }
+
+    /**
+     * @brief Returns the full resolution size of the image.
+     * @return The size of the image, empty if the image is not open.
+     */
+    cv::Size size() const { return imageSize; }
+
+    /**
+     * @brief Reads a region of the image. Only the tiles covering the region are decoded.
+     * @param region The region in full resolution coordinates, clipped to the image.
+     * @param result The pixels of the region. Reused if it already has the size of the clipped region,
+     *        so a region can be read straight into a view of another image.
+     * @return False if the region is outside of the image.
+     */
+    bool read(const cv::Rect& region, cv::Mat& result);
+
+private:
+    using Tile = std::pair<int, cv::Mat>;
+
+    std::string imagePath; ///< Path of the image file.
+    std::string tilePath; ///< Path of the cache directory holding the tiles of this image.
+    cv::Size imageSize; ///< Full resolution size of the image.
+    int tileSize = 0; ///< Side length of the square tiles.
+    int columns = 0; ///< Number of tile columns.
+    size_t budgetBytes; ///< Memory budget of the tile cache.
+    size_t usedBytes = 0; ///< Memory used by the cached tiles.
+
+    std::list<Tile> tiles; ///< Cached tiles, most recently used first.
+    std::unordered_map<int, std::list<Tile>::iterator> tileIndex; ///< Maps tile numbers to cached tiles.
+
+    /**
+     * @brief Reads the metadata file of the tiles.
+     * @param fileSize The current size of the image file.
+     * @param mtime The current modification time of the image file.
+     * @return True if the tiles exist and match the image file.
+     */
+    bool readMeta(std::uintmax_t fileSize, long long mtime);
+
+    /**
+     * @brief Decodes the image once and writes its tiles and metadata file. The decoded image is released
+     * when the tiles are written, later reads decode single tiles only.
+     * @param fileSize The current size of the image file.
+     * @param mtime The current modification time of the image file.
+     * @return True if all tiles were written.
+     */
+    bool build(std::uintmax_t fileSize, long long mtime);
+
+    /**
+     * @brief Removes the tiles of the least recently used images until all tiles fit into the disk budget.
+     * The tiles of this image are kept.
+     */
+    void evictTiles() const;
+
+    /**
+     * @brief Returns a tile from the cache, decoding it on a miss.
+     * @param row The row of the tile.
+     * @param column The column of the tile.
+     * @return The tile, or an empty image if it cannot be read.
+     */
+    cv::Mat tile(int row, int column);
+
+    /**
+     * @brief Returns the path of a tile file.
+     * @param row The row of the tile.
+     * @param column The column of the tile.
+     * @return The path of the tile file.
+     */
+    std::string tileFile(int row, int column) const;
+};
+
+#endif // TILEDIMAGE_H
@@ -1,12 +1,35 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
+#include <CommonConstants.h>
 namespace constants {
     const std::string dataPath = "../Data/orchard_dataset_image - small";
     constexpr int width = 192;
     constexpr int height = 108;
-    const std::vector<std::string> welcomeMessage = {"Welcome to the Image Viewer!","Write the image number and press Enter to display the image.","Press 'q' to quit.","By clicking on the images you can select ROIs","Prepared by: Ahmet Furkan Akinci"};
+    constexpr int maxCellWidth = 960; // Frames are decoded at a reduced resolution to fit into a grid cell
+    constexpr int maxCellHeight = 540;
+    constexpr size_t cacheBudgetBytes = 512 * 1024 * 1024; // Memory budget of the decoded frame cache
+    constexpr int pollDelay = 15; // Milliseconds to wait for a key press before checking pending decodes
+    const std::string loadingMessage = "Loading...";
+    const std::string traceFile = "trace.json"; // Chrome trace written when 't' is pressed
+    const std::string thumbnailDirectory = ".thumbnails"; // Sidecar directory inside the data directory
+    const std::string thumbnailIndexFile = "index.txt";
+    const std::vector<int> thumbnailSizes = {256, 128, 64}; // Longest side of each pyramid level
+    constexpr int thumbnailQuality = 90;
+    constexpr unsigned int thumbnailBuilders = 2; // Threads building thumbnails, the viewer's decoders keep the other cores
+    constexpr int contactSheetLevel = 1; // Thumbnail pyramid level shown in the contact sheet
+    constexpr int contactSheetMargin = 4;
+    constexpr size_t tileCacheSize = 1024; // Number of decoded contact sheet tiles kept in memory
+    const std::string tileDirectory = "ee576_tiles"; // Full resolution tile cache in the system temporary directory, the data directory is never written
+    const std::string tileMetaFile = "meta.txt";
+    constexpr int tileSize = 512; // Side length of the full resolution tiles
+    constexpr int tileCompression = 1; // PNG compression level of the tiles, they are lossless so crops keep the source pixels
+    constexpr size_t tileCacheBytes = 256 * 1024 * 1024; // Memory budget of the full resolution tile cache
+    constexpr std::uintmax_t tileDiskBudgetBytes = 8ull * 1024 * 1024 * 1024; // Disk budget of the tiles of all images, the least recently used images are removed first
+    const std::vector<std::string> welcomeMessage = {"Welcome to the Image Viewer!","Write the image number and press Enter to display the image.","Press 'q' to quit.","By clicking on the images you can select ROIs","Press 'c' for the contact sheet, scroll with 'w'/'s' or the mouse wheel","Press 'z' for full resolution, pan with 'w'/'a'/'s'/'d'","Press 'h' for stage timings, 't' to save them as a trace","Prepared by: Ahmet Furkan Akinci"};
 }
 
 #endif // CONSTANTS_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <BatchProcessor.h>
+#include <constants.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+
+bool BatchProcessor::loadJobs(const string& jobsPath) {
+    ifstream input(jobsPath);
+    if (!input) {
+        cerr << "ERROR: Could not open job list: " << jobsPath << endl;
+        return false;
+    }
+    jobs.clear();
+    string line;
+    int lineNumber = 0;
+    while (getline(input, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        // Split the line at commas, image paths may contain spaces
+        vector<string> fields;
+        stringstream stream(line);
+        string field;
+        while (getline(stream, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 3 && fields.size() != 5) {
+            cerr << "Warning: Skipping malformed job on line " << lineNumber << endl;
+            continue;
+        }
+        try {
+            CropJob job;
+            job.image = fields[0];
+            job.center = Point(stoi(fields[1]), stoi(fields[2]));
+            job.width = fields.size() == 5 ? stoi(fields[3]) : constants::width;
+            job.height = fields.size() == 5 ? stoi(fields[4]) : constants::height;
+            job.line = lineNumber;
+            jobs.push_back(job);
+        } catch (const exception&) {
+            cerr << "Warning: Skipping malformed job on line " << lineNumber << endl;
+        }
+    }
+    // Group the jobs by image
+    stable_sort(jobs.begin(), jobs.end(), [](const CropJob& a, const CropJob& b) { return a.image < b.image; });
+    return true;
+}
+
+int BatchProcessor::run(const string& outputPath, unsigned int numThreads) {
+    error_code error;
+    filesystem::create_directories(outputPath, error);
+    if (error) {
+        cerr << "ERROR: Could not create output directory: " << outputPath << " (" << error.message() << ")" << endl;
+        // None of the jobs can be written
+        return max<size_t>(1, jobs.size());
+    }
+
+    // Find the range of jobs belonging to each image
+    vector<pair<size_t, size_t>> images;
+    for (size_t i = 0; i < jobs.size();) {
+        size_t j = i;
+        while (j < jobs.size() && jobs[j].image == jobs[i].image) j++;
+        images.emplace_back(i, j);
+        i = j;
+    }
+
+    if (numThreads == 0) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    numThreads = min<unsigned int>(numThreads, max<size_t>(1, images.size()));
+
+    // Workers take the next unprocessed image until all are done
+    atomic<size_t> nextImage{0};
+    atomic<int> failed{0};
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        workers.emplace_back([&] {
+            for (size_t i = nextImage++; i < images.size(); i = nextImage++) {
+                failed += processImage(images[i].first, images[i].second, outputPath);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Processed " << jobs.size() << " jobs on " << images.size() << " images with " << numThreads
+         << " threads in " << seconds << " s" << endl;
+    if (seconds > 0) {
+        cout << "Throughput: " << images.size() / seconds << " images/s, " << jobs.size() / seconds << " crops/s" << endl;
+    }
+    if (failed > 0) {
+        cerr << failed << " jobs failed" << endl;
+    }
+    return failed;
+}
+
+int BatchProcessor::processImage(size_t first, size_t last, const string& outputPath) {
+    Mat img = imread(jobs[first].image);
+    if (img.empty()) {
+        cerr << "Warning: Could not read image: " << jobs[first].image << endl;
+        return last - first;
+    }
+
+    filesystem::path imagePath(jobs[first].image);
+    string stem = imagePath.stem().string();
+    string extension = imagePath.extension().string();
+    int failed = 0;
+    Mat rotated;
+    for (size_t i = first; i < last; i++) {
+        const CropJob& job = jobs[i];
+        Mat cropped = cropRectangle(img, job.center, job.width, job.height);
+        if (cropped.empty()) {
+            cerr << "Warning: ROI outside of the image on line " << job.line << endl;
+            failed++;
+            continue;
+        }
+        // Rotating the crop equals cropping the rotated image at the mirrored point
+        rotate(cropped, rotated, ROTATE_180);
+
+        string prefix = outputPath + "/" + stem + "_" + to_string(job.line);
+        if (!imwrite(prefix + "_crop" + extension, cropped) || !imwrite(prefix + "_rotated" + extension, rotated)) {
+            cerr << "Warning: Could not write the outputs of line " << job.line << endl;
+            failed++;
+        }
+    }
+    return failed;
+}
+
+cv::Mat BatchProcessor::cropRectangle(const cv::Mat& img, const cv::Point& center, int width, int height) {
+    Rect roi(max(center.x - width / 2, 0), max(center.y - height / 2, 0), width, height);
+    // Adjust ROI to be within the image boundaries
+    roi = roi & Rect(0, 0, img.cols, img.rows);
+    return img(roi);
+}
@@ -0,0 +1,136 @@
+#include <ContactSheet.h>
+#include <constants.h>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+ContactSheet::ContactSheet(ThumbnailStore& thumbnails, AsyncImageLoader& loader) : thumbnails(thumbnails), loader(loader) {}
+
+void ContactSheet::setFiles(const vector<string>& files) {
+    this->files = files;
+    scroll(0);
+}
+
+void ContactSheet::render(Mat& canvas) {
+    canvas.setTo(Scalar::all(0));
+    int cell = cellSize();
+    columns = max(1, canvas.cols / cell);
+    visibleRows = max(1, canvas.rows / cell);
+    scroll(0);
+
+    int first = firstRow * columns;
+    int last = min<int>(files.size(), first + visibleRows * columns);
+    for (int i = first; i < last; i++) {
+        Rect cellRect(((i - first) % columns) * cell, ((i - first) / columns) * cell, cell, cell);
+        Mat target = canvas(cellRect);
+
+        Mat tile;
+        if (lookup(files[i], tile)) {
+            // Center the tile in its cell
+            Rect tileRect((cell - tile.cols) / 2, (cell - tile.rows) / 2, tile.cols, tile.rows);
+            tile.copyTo(target(tileRect & Rect(0, 0, cell, cell)));
+        } else {
+            request(files[i]);
+            int margin = constants::contactSheetMargin;
+            rectangle(target, Rect(margin, margin, cell - 2 * margin, cell - 2 * margin), Scalar(40, 40, 40), FILLED);
+        }
+        putText(target, to_string(i + 1), Point(4, cell - 6), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 255), 1);
+    }
+
+    // Queue the row below the view so that scrolling down finds it decoded
+    int prefetchEnd = min<int>(files.size(), last + columns);
+    for (int i = last; i < prefetchEnd; i++) {
+        Mat tile;
+        if (!lookup(files[i], tile)) {
+            request(files[i]);
+        }
+    }
+}
+
+bool ContactSheet::update() {
+    bool arrived = false;
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        if (!AsyncImageLoader::isReady(it->second)) {
+            ++it;
+            continue;
+        }
+        // Cancelled jobs leave an empty tile behind, they are requested again when visible
+        Mat tile = it->second.get();
+        if (!tile.empty() && !tileIndex.count(it->first)) {
+            tiles.emplace_front(it->first, tile);
+            tileIndex[it->first] = tiles.begin();
+            if (tiles.size() > constants::tileCacheSize) {
+                tileIndex.erase(tiles.back().first);
+                tiles.pop_back();
+            }
+            arrived = true;
+        }
+        it = inFlight.erase(it);
+    }
+    return arrived;
+}
+
+void ContactSheet::scroll(int rows) {
+    int totalRows = (int(files.size()) + columns - 1) / columns;
+    int newFirstRow = clamp(firstRow + rows, 0, max(0, totalRows - visibleRows));
+    if (newFirstRow != firstRow) {
+        // Tiles queued for the previous view are stale now, the frame decodes sharing the loader are not
+        loader.cancelPending(this);
+    }
+    firstRow = newFirstRow;
+}
+
+int ContactSheet::hitTest(const Point& point) const {
+    int cell = cellSize();
+    int column = point.x / cell;
+    int row = point.y / cell;
+    if (point.x < 0 || point.y < 0 || column >= columns || row >= visibleRows) {
+        return -1;
+    }
+    int index = (firstRow + row) * columns + column;
+    return index < files.size() ? index : -1;
+}
+
+int ContactSheet::cellSize() {
+    return constants::thumbnailSizes[constants::contactSheetLevel] + 2 * constants::contactSheetMargin;
+}
+
+bool ContactSheet::lookup(const string& path, Mat& tile) {
+    auto it = tileIndex.find(path);
+    if (it == tileIndex.end()) {
+        return false;
+    }
+    // Move the tile to the front of the list
+    tiles.splice(tiles.begin(), tiles, it->second);
+    tile = it->second->second;
+    return true;
+}
+
+void ContactSheet::request(const string& path) {
+    if (inFlight.count(path)) {
+        return;
+    }
+    ThumbnailStore& store = thumbnails;
+    inFlight[path] = loader.submit<Mat>([&store, path] { return decodeTile(store, path); }, this);
+}
+
+Mat ContactSheet::decodeTile(ThumbnailStore& thumbnails, const string& path) {
+    int size = constants::thumbnailSizes[constants::contactSheetLevel];
+    Mat tile = thumbnails.load(path, constants::contactSheetLevel);
+    if (tile.empty()) {
+        // The thumbnail is not built yet, decode the source at the smallest resolution instead
+        tile = imread(path, IMREAD_REDUCED_COLOR_8);
+        if (tile.empty()) {
+            // Mark images that cannot be decoded so that they are not requested again
+            tile = Mat(size, size, CV_8UC3, Scalar(0, 0, 80));
+            putText(tile, "?", Point(size / 2 - 8, size / 2 + 8), FONT_HERSHEY_SIMPLEX, 1, Scalar(255, 255, 255), 2);
+            return tile;
+        }
+    }
+    double scale = double(size) / max(tile.cols, tile.rows);
+    if (scale < 1.0) {
+        resize(tile, tile, Size(), scale, scale, INTER_AREA);
+    }
+    return tile;
+}
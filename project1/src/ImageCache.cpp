@@ -0,0 +1,98 @@
+#include <ImageCache.h>
+#include <Profiler.h>
+
+using namespace cv;
+using namespace std;
+
+ImageCache::ImageCache(size_t budgetBytes, AsyncImageLoader& loader) : budgetBytes(budgetBytes), loader(loader) {}
+
+shared_future<CachedFrame> ImageCache::request(const string& path) {
+    lock_guard<mutex> lock(cacheMutex);
+    // The job decodes with the flags of the request, even if they change while it is queued
+    int flags = decodeFlags;
+    string key = cacheKey(path, flags);
+    CachedFrame frame;
+    if (lookup(key, frame)) {
+        promise<CachedFrame> cached;
+        cached.set_value(frame);
+        return cached.get_future().share();
+    }
+
+    // Jobs cancelled by the loader leave an empty frame behind, those are queued again
+    auto it = inFlight.find(key);
+    if (it != inFlight.end() && !(AsyncImageLoader::isReady(it->second) && it->second.get().image.empty())) {
+        return it->second;
+    }
+
+    shared_future<CachedFrame> future = loader.submit<CachedFrame>([this, path, flags, key] {
+        CachedFrame frame = decode(path, flags);
+        lock_guard<mutex> lock(cacheMutex);
+        if (!frame.image.empty()) {
+            insert(key, frame);
+        }
+        inFlight.erase(key);
+        return frame;
+    });
+    inFlight[key] = future;
+    return future;
+}
+
+void ImageCache::setDecodeFlags(int flags) {
+    lock_guard<mutex> lock(cacheMutex);
+    decodeFlags = flags;
+}
+
+void ImageCache::prefetch(const vector<string>& paths) {
+    for (const auto& path : paths) {
+        request(path);
+    }
+}
+
+CachedFrame ImageCache::decode(const string& path, int flags) {
+    CachedFrame frame;
+    {
+        ScopedTimer timer("decode");
+        frame.image = imread(path, flags);
+    }
+    if (!frame.image.empty()) {
+        ScopedTimer timer("rotate");
+        rotate(frame.image, frame.rotated, ROTATE_180);
+    }
+    return frame;
+}
+
+string ImageCache::cacheKey(const string& path, int flags) {
+    return to_string(flags) + ':' + path;
+}
+
+bool ImageCache::lookup(const string& key, CachedFrame& frame) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return false;
+    }
+    // Move the entry to the front of the list
+    entries.splice(entries.begin(), entries, it->second);
+    frame = it->second->second;
+    return true;
+}
+
+void ImageCache::insert(const string& key, const CachedFrame& frame) {
+    size_t bytes = frameBytes(frame);
+    if (bytes > budgetBytes || index.count(key)) {
+        return;
+    }
+    entries.emplace_front(key, frame);
+    index[key] = entries.begin();
+    usedBytes += bytes;
+
+    // Evict the least recently used frames
+    while (usedBytes > budgetBytes) {
+        usedBytes -= frameBytes(entries.back().second);
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+size_t ImageCache::frameBytes(const CachedFrame& frame) {
+    return frame.image.total() * frame.image.elemSize() + frame.rotated.total() * frame.rotated.elemSize();
+}
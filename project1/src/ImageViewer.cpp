@@ -1,4 +1,5 @@
 #include <ImageViewer.h>
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <constants.h>
@@ -6,13 +7,30 @@
 using namespace cv;
 using namespace std;
 
-ImageViewer::ImageViewer() : N1(0), N2(0) {}
+ImageViewer::ImageViewer() : N1(0), N2(0), cache(constants::cacheBudgetBytes, loader) {}
 
 void ImageViewer::loadImages(const string& path) {
-    files = getFiles(path);
+    // Scan the directory once, later changes are applied by refreshFiles
+    directory = make_unique<DirectoryIndex>(path);
+    files = directory->files();
     if (!files.empty()) {
+        // Build the missing thumbnails in the background
+        thumbnails = make_unique<ThumbnailStore>(path);
+        thumbnails->build(files);
+        contactSheet = make_unique<ContactSheet>(*thumbnails, loader);
+        contactSheet->setFiles(files);
+
+        // Decode a small version first to choose the display scale without a full decode
+        Mat probe = imread(files[0], IMREAD_REDUCED_COLOR_8);
+        if (probe.empty()) {
+            cerr << "Failed to load images. Check path in constants.h" << endl;
+            return;
+        }
+        displayScale = chooseDisplayScale(Size(probe.cols * 8, probe.rows * 8));
+        cache.setDecodeFlags(reducedColorFlag(displayScale));
+
         // Assuming the first file is the target
-        img = imread(files[0]);
+        Mat img = imread(files[0], reducedColorFlag(displayScale));
         if (img.empty()) {
             cerr << "Failed to load images. Check path in constants.h" << endl;
             return;
@@ -22,12 +40,7 @@ void ImageViewer::loadImages(const string& path) {
         N1 = img.rows;
         N2 = img.cols;
 
-        // Resize for display if necessary
-        displayImage = img.clone();
-        rotate(displayImage, rotatedImg, ROTATE_180);
-
-        // Prepare the grid
-        grid = Mat::zeros(N1 * 2, N2 * 2, img.type());
+        // Prepare the grid, it is allocated once and every view is drawn into it
         // Copy welcome screen to the grid full screen
         // resize grid size
         grid = createWelcomeScreen(constants::welcomeMessage, N2 * 2, N1 * 2);
@@ -40,20 +53,120 @@ void ImageViewer::displayImages(int num) {
             cerr << "Invalid image number." << endl;
             return;
         }
-        img = imread(files[num-1]);
-        if (img.empty()) {
-            cerr << "Failed to load image." << endl;
-            return;
+        // Leave the contact sheet and clear its thumbnails from the grid
+        if (contactSheetMode) {
+            contactSheetMode = false;
+            grid.setTo(Scalar::all(0));
         }
+        detailMode = false;
 
-        // Resize for display if necessary
-        displayImage = img.clone();
-        rotate(displayImage, rotatedImg, ROTATE_180);
+        // Decode jobs of the previously selected image are stale now
+        loader.cancelPending();
+        pendingTiles = shared_future<shared_ptr<TiledImage>>();
+        pendingDetail = false;
+        pendingCrop = -1;
+        requestTime = Profiler::Clock::now();
+        pendingImage = num;
+        pendingFrame = cache.request(files[num-1]);
 
+        // Decode the neighbouring images while this one is on screen
+        vector<string> neighbours;
+        if (num > 1) neighbours.push_back(files[num-2]);
+        if (num < files.size()) neighbours.push_back(files[num]);
+        cache.prefetch(neighbours);
+
+        if (AsyncImageLoader::isReady(pendingFrame)) {
+            showPendingFrame();
+        } else {
+            drawPlaceholder(grid, 0);
+            drawPlaceholder(grid, 1);
+            showGrid();
+        }
+    }
+}
+
+void ImageViewer::showPendingFrame() {
+    if (pendingImage == -1 || !AsyncImageLoader::isReady(pendingFrame)) {
+        return;
+    }
+    CachedFrame frame = pendingFrame.get();
+    int number = pendingImage;
+    pendingImage = -1;
+    if (frame.image.empty()) {
+        cerr << "Failed to load image." << endl;
+        return;
+    }
+    shownImage = number;
+
+    // Cached frames are shared, they are never modified in place
+    displayImage = frame.image;
+    rotatedImg = frame.rotated;
+
+    {
+        ScopedTimer timer("composite");
         fillGrid(grid, displayImage, 0);
         fillGrid(grid, rotatedImg, 1);
+    }
+    showGrid();
+    // Time from the request of the image until it is on screen
+    Profiler::instance().record("latency", requestTime, Profiler::Clock::now());
+}
+
+void ImageViewer::showPendingTiles() {
+    if (!AsyncImageLoader::isReady(pendingTiles)) {
+        return;
+    }
+    shared_ptr<TiledImage> image = pendingTiles.get();
+    pendingTiles = shared_future<shared_ptr<TiledImage>>();
+    bool detail = pendingDetail;
+    int crop = pendingCrop;
+    pendingDetail = false;
+    pendingCrop = -1;
+    if (!image) {
+        cerr << "Failed to read full resolution image." << endl;
+        // Replace the placeholders
+        if (detail && detailMode) {
+            detailMode = false;
+            fillGrid(grid, displayImage, 0);
+            fillGrid(grid, rotatedImg, 1);
+        }
+        if (crop != -1) {
+            gridCell(crop).setTo(Scalar::all(0));
+        }
+        showGrid();
+        return;
+    }
+    tiledImage = image;
+    if (detail && detailMode) {
+        // Start at the center of the image
+        viewport = Point((image->size().width - N2) / 2, (image->size().height - N1) / 2);
+        panDetail(0, 0);
+    }
+    if (crop != -1) {
+        showCrop(pendingCropPoint, crop == 3);
+    }
+}
+
+void ImageViewer::showGrid() {
+    ScopedTimer timer("imshow");
+    if (!Profiler::instance().overlayEnabled()) {
         imshow("Display", grid);
+        return;
     }
+    // Draw the overlay on a copy so that the grid stays clean
+    grid.copyTo(overlayBuffer);
+    Profiler::instance().drawOverlay(overlayBuffer);
+    imshow("Display", overlayBuffer);
+}
+
+void ImageViewer::drawPlaceholder(Mat& grid, int position) {
+    Mat targetROI = grid(Rect((position % 2) * N2, (position / 2) * N1, N2, N1));
+    targetROI.setTo(Scalar(40, 40, 40));
+
+    int baseline = 0;
+    Size textSize = getTextSize(constants::loadingMessage, FONT_HERSHEY_SIMPLEX, 2, 4, &baseline);
+    Point textOrg((N2 - textSize.width) / 2, (N1 + textSize.height) / 2);
+    putText(targetROI, constants::loadingMessage, textOrg, FONT_HERSHEY_SIMPLEX, 2, Scalar(255, 255, 255), 4);
 }
 
 cv::Mat ImageViewer::cropRectangle(const cv::Mat& img, const cv::Point& center, int width, int height) {
@@ -63,50 +176,171 @@ cv::Mat ImageViewer::cropRectangle(const cv::Mat& img, const cv::Point& center,
     return img(roi).clone();
 }
 
+bool ImageViewer::cropSource(const cv::Point& cellPoint, bool rotated, cv::Mat& cropped) {
+    TiledImage* source = openTiledImage();
+    if (!source) {
+        return false;
+    }
+    // Map the point from the grid cell to source pixels
+    Point center = detailMode ? viewport + cellPoint
+                              : Point(cellPoint.x * source->size().width / displayImage.cols,
+                                      cellPoint.y * source->size().height / displayImage.rows);
+    Rect roi(max(center.x - width / 2, 0), max(center.y - height / 2, 0), width, height);
+    return readRegion(*source, roi, rotated, cropped);
+}
+
+bool ImageViewer::readRegion(TiledImage& source, const cv::Rect& region, bool rotated, cv::Mat& pixels) {
+    Rect roi = region & Rect(Point(0, 0), source.size());
+    if (!rotated) {
+        return source.read(roi, pixels);
+    }
+    // Read the mirrored window of the source and rotate it in place instead of rotating the full frame
+    Rect mirrored(source.size().width - roi.x - roi.width, source.size().height - roi.y - roi.height, roi.width, roi.height);
+    if (!source.read(mirrored, pixels)) {
+        return false;
+    }
+    flip(pixels, pixels, -1);
+    return true;
+}
+
+TiledImage* ImageViewer::openTiledImage() {
+    if (shownImage == -1) {
+        return nullptr;
+    }
+    const string& file = files[shownImage - 1];
+    if (tiledImage && tiledImage->path() == file) {
+        return tiledImage.get();
+    }
+    if (!pendingTiles.valid() || pendingTilesPath != file) {
+        // Release the tiles of the previous image before opening the next one
+        tiledImage.reset();
+        // Building the tiles decodes the full image, so it runs on the loader and is polled by waitForKey
+        pendingTilesPath = file;
+        pendingTiles = loader.submit<shared_ptr<TiledImage>>([file] {
+            auto image = make_shared<TiledImage>(file, constants::tileCacheBytes);
+            return image->open() ? image : nullptr;
+        });
+    }
+    return nullptr;
+}
+
+int ImageViewer::chooseDisplayScale(const cv::Size& size) {
+    // libjpeg can decode straight to 1/2, 1/4 and 1/8 of the full resolution
+    int scale = 1;
+    while (scale < 8 && (size.width / scale > constants::maxCellWidth || size.height / scale > constants::maxCellHeight)) {
+        scale *= 2;
+    }
+    return scale;
+}
+
+int ImageViewer::reducedColorFlag(int scale) {
+    switch (scale) {
+        case 2: return IMREAD_REDUCED_COLOR_2;
+        case 4: return IMREAD_REDUCED_COLOR_4;
+        case 8: return IMREAD_REDUCED_COLOR_8;
+        default: return IMREAD_COLOR;
+    }
+}
+
+Mat ImageViewer::gridCell(int position) {
+    return grid(Rect((position % 2) * N2, (position / 2) * N1, N2, N1));
+}
+
 void ImageViewer::fillGrid(Mat& grid, const Mat& img, int position) {
     Mat targetROI = grid(Rect((position % 2) * N2, (position / 2) * N1, img.cols, img.rows));
     img.copyTo(targetROI);
 }
 
-vector<string> ImageViewer::getFiles(const string& path) {
-    vector<string> files;
-    try {
-        if (!filesystem::exists(path)) {
-            cerr << "ERROR: Path does not exist. Correct it in constants.h file" << endl;
-            return files;
+void ImageViewer::refreshFiles() {
+    if (!directory || !directory->poll()) {
+        return;
+    }
+    vector<string> previous = std::move(files);
+    files = directory->files();
+    cout << "Data directory changed, " << files.size() << " images" << endl;
+
+    // Keep the image numbers pointing at the same files
+    auto renumber = [&](int number) {
+        if (number < 1 || number > previous.size()) {
+            return -1;
         }
-        for (const auto& entry : filesystem::directory_iterator(path)) {
-            files.push_back(entry.path().string());
+        auto it = find(files.begin(), files.end(), previous[number - 1]);
+        return it == files.end() ? -1 : int(it - files.begin()) + 1;
+    };
+    shownImage = renumber(shownImage);
+    pendingImage = renumber(pendingImage);
+    selectedImage = renumber(selectedImage);
+
+    if (thumbnails) {
+        thumbnails->build(files);
+    }
+    if (contactSheet) {
+        contactSheet->setFiles(files);
+        if (contactSheetMode) {
+            showContactSheet();
         }
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << e.what() << endl;
-        return files;
     }
-    return files;
 }
 
 void ImageViewer::mouseCallback(int event, int x, int y, int flags, void* userdata) {
     // Cast userdata to ImageViewer pointer
     auto* processor = reinterpret_cast<ImageViewer*>(userdata);
-    if (processor->selectedImage == -1) {
+    if (processor->contactSheetMode) {
+        if (event == EVENT_MOUSEWHEEL) {
+            processor->contactSheet->scroll(getMouseWheelDelta(flags) > 0 ? -1 : 1);
+            processor->showContactSheet();
+        } else if (event == EVENT_LBUTTONDOWN) {
+            // Open the clicked image
+            int index = processor->contactSheet->hitTest(Point(x, y));
+            if (index != -1) {
+                processor->selectedImage = index + 1;
+                processor->displayImages(index + 1);
+                std::cout << index + 1 << std::endl;
+            }
+        }
+        return;
+    }
+    if (processor->selectedImage == -1 || processor->displayImage.empty()) {
         return;
     }
     if (event == EVENT_LBUTTONDOWN) {
         if (x < processor->N2 && y < processor->N1) { // First image
             processor->point1 = Point(x, y);
-            Mat cropped = processor->cropRectangle(processor->displayImage, processor->point1, width, height);
-            resize(cropped, cropped, Size(processor->N2, processor->N1));
-            processor->fillGrid(processor->grid, cropped, 2);
+            processor->showCrop(processor->point1, false);
         } else if (x >= processor->N2 && y < processor->N1) { // Second image (rotated)
             Point correctedPoint = Point(x - processor->N2, y);
-            Mat cropped = processor->cropRectangle(processor->rotatedImg, correctedPoint, width, height);
-            resize(cropped, cropped, Size(processor->N2, processor->N1));
-            processor->fillGrid(processor->grid, cropped, 3);
+            processor->showCrop(correctedPoint, true);
         }
-        imshow("Display", processor->grid);
     }
 }
 
+void ImageViewer::showCrop(const cv::Point& cellPoint, bool rotated) {
+    int position = rotated ? 3 : 2;
+    {
+        ScopedTimer timer("crop");
+        if (!cropSource(cellPoint, rotated, cropBuffer)) {
+            if (pendingTiles.valid()) {
+                // The tiles are being built, the latest click is cropped once they are ready
+                if (pendingCrop != -1 && pendingCrop != position) {
+                    gridCell(pendingCrop).setTo(Scalar::all(0));
+                }
+                pendingCrop = position;
+                pendingCropPoint = cellPoint;
+                drawPlaceholder(grid, position);
+                showGrid();
+            }
+            return;
+        }
+    }
+    {
+        ScopedTimer timer("resize");
+        // Resize straight into the grid cell
+        Mat target = gridCell(position);
+        resize(cropBuffer, target, target.size());
+    }
+    showGrid();
+}
+
 cv::Mat ImageViewer::createWelcomeScreen(const std::vector<std::string>& messages, int width, int height) {
 
     // Create a black image
@@ -143,11 +377,35 @@ cv::Mat ImageViewer::createWelcomeScreen(const std::vector<std::string>& message
 void ImageViewer::run() {
     namedWindow("Display", WINDOW_AUTOSIZE);
     setMouseCallback("Display", ImageViewer::mouseCallback, this);
-    imshow("Display", grid);
+    showGrid();
 
     while (true) {
-        char key = waitKey(0);
+        char key = waitForKey();
         if (key == 'q') break;
+        else if (key == 'c') {
+            toggleContactSheet();
+        }
+        else if (key == 'z') {
+            toggleDetail();
+        }
+        else if (key == 'h') {
+            Profiler::instance().toggleOverlay();
+            showGrid();
+        }
+        else if (key == 't') {
+            Profiler::instance().writeTrace(constants::traceFile);
+        }
+        // Scroll the contact sheet with w and s keys
+        else if (contactSheetMode && (key == 'w' || key == 's')) {
+            contactSheet->scroll(key == 'w' ? -1 : 1);
+            showContactSheet();
+        }
+        // Pan the full resolution view with w, a, s and d keys
+        else if (detailMode && (key == 'w' || key == 'a' || key == 's' || key == 'd')) {
+            int dx = key == 'a' ? -N2 / 2 : key == 'd' ? N2 / 2 : 0;
+            int dy = key == 'w' ? -N1 / 2 : key == 's' ? N1 / 2 : 0;
+            panDetail(dx, dy);
+        }
         else if (key >= '0' && key <= '9') {
             // If the key is a digit, we process it to construct a number
             string numberStr = "";
@@ -155,7 +413,7 @@ void ImageViewer::run() {
 
             // Continue to capture digits until Enter is pressed
             while(true) {
-                key = waitKey(0);
+                key = waitForKey();
                 if (key == 13 || key == 10) { // If Enter is pressed, break
                     // Convert the captured string to an integer
                     int number = atoi(numberStr.c_str());
@@ -171,4 +429,95 @@ void ImageViewer::run() {
 
         }
     }
-}
\ No newline at end of file
+}
+
+char ImageViewer::waitForKey() {
+    while (true) {
+        int key = waitKey(constants::pollDelay);
+        if (key != -1) {
+            return key;
+        }
+        // Show the frames and tiles that finished decoding while no key is pressed
+        refreshFiles();
+        showPendingFrame();
+        showPendingTiles();
+        if (contactSheetMode && contactSheet->update()) {
+            showContactSheet();
+        }
+    }
+}
+
+void ImageViewer::toggleContactSheet() {
+    if (!contactSheet) {
+        return;
+    }
+    contactSheetMode = !contactSheetMode;
+    detailMode = false;
+    if (contactSheetMode) {
+        showContactSheet();
+    } else if (shownImage != -1) {
+        grid.setTo(Scalar::all(0));
+        displayImages(shownImage);
+    } else {
+        grid = createWelcomeScreen(constants::welcomeMessage, N2 * 2, N1 * 2);
+        showGrid();
+    }
+}
+
+void ImageViewer::showContactSheet() {
+    {
+        ScopedTimer timer("contact sheet");
+        contactSheet->render(grid);
+    }
+    showGrid();
+}
+
+void ImageViewer::toggleDetail() {
+    if (contactSheetMode || shownImage == -1 || displayImage.empty()) {
+        return;
+    }
+    detailMode = !detailMode;
+    if (!detailMode) {
+        pendingDetail = false;
+        fillGrid(grid, displayImage, 0);
+        fillGrid(grid, rotatedImg, 1);
+        showGrid();
+        return;
+    }
+    TiledImage* source = openTiledImage();
+    if (!source) {
+        // The view opens once the tiles are ready
+        pendingDetail = true;
+        drawPlaceholder(grid, 0);
+        drawPlaceholder(grid, 1);
+        showGrid();
+        return;
+    }
+    // Start at the center of the image
+    viewport = Point((source->size().width - N2) / 2, (source->size().height - N1) / 2);
+    panDetail(0, 0);
+}
+
+void ImageViewer::panDetail(int dx, int dy) {
+    TiledImage* source = openTiledImage();
+    if (!source) {
+        return;
+    }
+    // Keep the view inside the image
+    viewport.x = clamp(viewport.x + dx, 0, max(0, source->size().width - N2));
+    viewport.y = clamp(viewport.y + dy, 0, max(0, source->size().height - N1));
+
+    ScopedTimer timer("detail view");
+    // Only the tiles under the view are decoded, straight into the grid cells
+    Rect view = Rect(viewport, Size(N2, N1)) & Rect(Point(0, 0), source->size());
+    for (int position = 0; position < 2; position++) {
+        Mat cell = gridCell(position);
+        if (view.size() != cell.size()) {
+            // Images smaller than a cell leave a border
+            cell.setTo(Scalar::all(0));
+        }
+        Mat target = cell(Rect(Point(0, 0), view.size()));
+        readRegion(*source, view, position == 1, target);
+    }
+    showGrid();
+}
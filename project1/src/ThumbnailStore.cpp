@@ -0,0 +1,174 @@
+#include <ThumbnailStore.h>
+#include <Profiler.h>
+#include <constants.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+ThumbnailStore::ThumbnailStore(const string& directory)
+    : storePath((filesystem::path(directory) / constants::thumbnailDirectory).string()) {
+    try {
+        filesystem::create_directories(storePath);
+    } catch (const filesystem::filesystem_error& e) {
+        cerr << "Thumbnails disabled: " << e.what() << endl;
+        enabled = false;
+        return;
+    }
+    readIndex();
+    builders = make_unique<AsyncImageLoader>(constants::thumbnailBuilders);
+}
+
+ThumbnailStore::~ThumbnailStore() {
+    // Stop the builders before writing the index of the finished thumbnails
+    builders.reset();
+    lock_guard<mutex> lock(indexMutex);
+    if (indexChanged) {
+        writeIndex();
+    }
+}
+
+void ThumbnailStore::build(const vector<string>& files) {
+    if (!enabled) {
+        return;
+    }
+    int queued = 0;
+    for (const auto& file : files) {
+        IndexEntry entry;
+        if (!statFile(file, entry)) {
+            continue;
+        }
+        string name = filesystem::path(file).filename().string();
+        {
+            lock_guard<mutex> lock(indexMutex);
+            // A rescan finds the files of the previous scan again, their builds are already queued
+            if (isFresh(file, entry) || !pending.insert(name).second) {
+                continue;
+            }
+        }
+        builders->submit<bool>([this, file, name, entry] {
+            bool built = buildEntry(file, entry);
+            lock_guard<mutex> lock(indexMutex);
+            if (built) {
+                index[name] = entry;
+                indexChanged = true;
+            }
+            pending.erase(name);
+            // Write the index once the last thumbnail is built
+            if (pending.empty() && indexChanged) {
+                writeIndex();
+            }
+            return built;
+        });
+        queued++;
+    }
+    if (queued > 0) {
+        cout << "Building thumbnails for " << queued << " images in " << storePath << endl;
+    }
+}
+
+Mat ThumbnailStore::load(const string& file, int level) {
+    IndexEntry entry;
+    if (!enabled || level < 0 || level >= levels() || !statFile(file, entry)) {
+        return Mat();
+    }
+    {
+        lock_guard<mutex> lock(indexMutex);
+        if (!isFresh(file, entry)) {
+            return Mat();
+        }
+    }
+    return imread(thumbnailPath(file, level));
+}
+
+int ThumbnailStore::levels() {
+    return constants::thumbnailSizes.size();
+}
+
+bool ThumbnailStore::buildEntry(const string& file, const IndexEntry& entry) {
+    ScopedTimer timer("thumbnail");
+    // The largest level is much smaller than the source, so decode at a reduced resolution when possible
+    int largest = constants::thumbnailSizes[0];
+    Mat image = imread(file, IMREAD_REDUCED_COLOR_4);
+    if (!image.empty() && max(image.cols, image.rows) < largest) {
+        image = imread(file);
+    }
+    if (image.empty()) {
+        return false;
+    }
+
+    vector<int> params = {IMWRITE_JPEG_QUALITY, constants::thumbnailQuality};
+    for (int level = 0; level < levels(); level++) {
+        // Each level is downscaled from the previous one
+        double scale = double(constants::thumbnailSizes[level]) / max(image.cols, image.rows);
+        if (scale < 1.0) {
+            resize(image, image, Size(), scale, scale, INTER_AREA);
+        }
+        if (!imwrite(thumbnailPath(file, level), image, params)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ThumbnailStore::statFile(const string& file, IndexEntry& entry) {
+    error_code error;
+    entry.size = filesystem::file_size(file, error);
+    if (error) {
+        return false;
+    }
+    auto mtime = filesystem::last_write_time(file, error);
+    if (error) {
+        return false;
+    }
+    entry.mtime = mtime.time_since_epoch().count();
+    return true;
+}
+
+bool ThumbnailStore::isFresh(const string& file, const IndexEntry& entry) const {
+    auto it = index.find(filesystem::path(file).filename().string());
+    return it != index.end() && it->second.size == entry.size && it->second.mtime == entry.mtime;
+}
+
+string ThumbnailStore::thumbnailPath(const string& file, int level) const {
+    return storePath + "/" + filesystem::path(file).filename().string() + "." + to_string(level) + ".jpg";
+}
+
+void ThumbnailStore::readIndex() {
+    ifstream input(storePath + "/" + constants::thumbnailIndexFile);
+    string line;
+    // Each line holds: file name, size, modification time separated by tabs
+    while (getline(input, line)) {
+        stringstream fields(line);
+        string name, size, mtime;
+        if (getline(fields, name, '\t') && getline(fields, size, '\t') && getline(fields, mtime, '\t')) {
+            try {
+                index[name] = IndexEntry{stoull(size), stoll(mtime)};
+            } catch (const exception&) {
+                // Skip corrupted lines, their thumbnails are rebuilt
+            }
+        }
+    }
+}
+
+void ThumbnailStore::writeIndex() {
+    // Write to a temporary file first so that an interrupted write keeps the old index
+    string indexPath = storePath + "/" + constants::thumbnailIndexFile;
+    {
+        ofstream output(indexPath + ".tmp");
+        for (const auto& [name, entry] : index) {
+            output << name << '\t' << entry.size << '\t' << entry.mtime << '\n';
+        }
+        if (!output) {
+            cerr << "Failed to write thumbnail index: " << indexPath << endl;
+            return;
+        }
+    }
+    error_code error;
+    filesystem::rename(indexPath + ".tmp", indexPath, error);
+    indexChanged = bool(error);
+}
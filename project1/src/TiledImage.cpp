@@ -0,0 +1,207 @@
+#include <TiledImage.h>
+#include <Profiler.h>
+#include <constants.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+TiledImage::TiledImage(const string& imagePath, size_t budgetBytes) : imagePath(imagePath), budgetBytes(budgetBytes) {
+    // Images with the same name in different directories get different cache directories
+    error_code error;
+    filesystem::path file = filesystem::absolute(imagePath, error);
+    if (error) {
+        file = imagePath;
+    }
+    string key = to_string(hash<string>()(file.string())) + "_" + file.filename().string();
+    tilePath = (filesystem::temp_directory_path(error) / constants::tileDirectory / key).string();
+}
+
+bool TiledImage::open() {
+    error_code error;
+    uintmax_t fileSize = filesystem::file_size(imagePath, error);
+    if (error) {
+        return false;
+    }
+    auto mtime = filesystem::last_write_time(imagePath, error);
+    if (error) {
+        return false;
+    }
+    long long ticks = mtime.time_since_epoch().count();
+    if (readMeta(fileSize, ticks)) {
+        // The metadata file's modification time marks the last use for the eviction
+        filesystem::last_write_time(tilePath + "/" + constants::tileMetaFile, filesystem::file_time_type::clock::now(), error);
+        return true;
+    }
+    if (!build(fileSize, ticks)) {
+        // Do not leave the tiles of a partial build behind
+        filesystem::remove_all(tilePath, error);
+        return false;
+    }
+    try {
+        evictTiles();
+    } catch (const filesystem::filesystem_error& e) {
+        // The tiles of this image are complete, the eviction is repeated after the next build
+        cerr << "Failed to evict tiles: " << e.what() << endl;
+    }
+    return true;
+}
+
+bool TiledImage::read(const Rect& region, Mat& result) {
+    Rect roi = region & Rect(Point(0, 0), imageSize);
+    if (roi.empty()) {
+        return false;
+    }
+    result.create(roi.size(), CV_8UC3);
+    for (int row = roi.y / tileSize; row <= (roi.br().y - 1) / tileSize; row++) {
+        for (int column = roi.x / tileSize; column <= (roi.br().x - 1) / tileSize; column++) {
+            Rect tileRect = Rect(column * tileSize, row * tileSize, tileSize, tileSize) & Rect(Point(0, 0), imageSize);
+            Rect overlap = tileRect & roi;
+            Mat target = result(overlap - roi.tl());
+            Mat pixels = tile(row, column);
+            if (pixels.size() != tileRect.size()) {
+                // Leave missing or corrupted tiles black
+                target.setTo(Scalar::all(0));
+                continue;
+            }
+            // Copy the part of the tile overlapping the region
+            pixels(overlap - tileRect.tl()).copyTo(target);
+        }
+    }
+    return true;
+}
+
+bool TiledImage::readMeta(uintmax_t fileSize, long long mtime) {
+    ifstream input(tilePath + "/" + constants::tileMetaFile);
+    uintmax_t size;
+    long long time;
+    int width, height, side;
+    // The metadata file holds: file size, modification time, width, height, tile size
+    if (!(input >> size >> time >> width >> height >> side) || size != fileSize || time != mtime || side <= 0) {
+        return false;
+    }
+    imageSize = Size(width, height);
+    tileSize = side;
+    columns = (width + side - 1) / side;
+    return true;
+}
+
+bool TiledImage::build(uintmax_t fileSize, long long mtime) {
+    // OpenCV cannot decode a region of a compressed image, so the image is decoded once here and released
+    // when its tiles are written. Later sessions read the tiles only.
+    cout << "Building tiles for " << imagePath << endl;
+    ScopedTimer timer("tile build");
+    Mat image = imread(imagePath);
+    if (image.empty()) {
+        return false;
+    }
+    // Start from an empty directory, so no tiles of an outdated build are left over
+    error_code error;
+    filesystem::remove_all(tilePath, error);
+    filesystem::create_directories(tilePath, error);
+    if (error) {
+        cerr << "Cannot create " << tilePath << ": " << error.message() << endl;
+        return false;
+    }
+
+    imageSize = image.size();
+    tileSize = constants::tileSize;
+    columns = (image.cols + tileSize - 1) / tileSize;
+    int rows = (image.rows + tileSize - 1) / tileSize;
+    // PNG is lossless, so a crop read from the tiles has exactly the pixels of the source image
+    vector<int> params = {IMWRITE_PNG_COMPRESSION, constants::tileCompression};
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            Rect tileRect = Rect(column * tileSize, row * tileSize, tileSize, tileSize) & Rect(Point(0, 0), imageSize);
+            if (!imwrite(tileFile(row, column), image(tileRect), params)) {
+                cerr << "Failed to write tile: " << tileFile(row, column) << endl;
+                return false;
+            }
+        }
+    }
+
+    // The metadata file is written last, so an interrupted build is repeated
+    ofstream output(tilePath + "/" + constants::tileMetaFile);
+    output << fileSize << ' ' << mtime << ' ' << imageSize.width << ' ' << imageSize.height << ' ' << tileSize << '\n';
+    return bool(output);
+}
+
+void TiledImage::evictTiles() const {
+    // Collect the tile directories of all images with their size and last use
+    struct Entry {
+        filesystem::path path; ///< Tile directory of an image.
+        filesystem::file_time_type used; ///< Last use of the tiles.
+        uintmax_t bytes; ///< Size of the tiles.
+    };
+    error_code error;
+    filesystem::path root = filesystem::path(tilePath).parent_path();
+    vector<Entry> entries;
+    uintmax_t total = 0;
+    for (const auto& directory : filesystem::directory_iterator(root, error)) {
+        if (!directory.is_directory(error)) {
+            continue;
+        }
+        Entry entry{directory.path(), {}, 0};
+        // Directories without a metadata file are interrupted builds and go first
+        entry.used = filesystem::last_write_time(directory.path() / constants::tileMetaFile, error);
+        if (error) {
+            entry.used = filesystem::file_time_type::min();
+        }
+        for (const auto& file : filesystem::directory_iterator(directory.path(), error)) {
+            uintmax_t size = file.file_size(error);
+            entry.bytes += error ? 0 : size;
+        }
+        total += entry.bytes;
+        entries.push_back(entry);
+    }
+
+    // Remove whole images, least recently used first, but keep the tiles just built
+    sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= constants::tileDiskBudgetBytes) {
+            break;
+        }
+        if (entry.path == filesystem::path(tilePath)) {
+            continue;
+        }
+        filesystem::remove_all(entry.path, error);
+        if (!error) {
+            total -= entry.bytes;
+        }
+    }
+}
+
+Mat TiledImage::tile(int row, int column) {
+    int number = row * columns + column;
+    auto it = tileIndex.find(number);
+    if (it != tileIndex.end()) {
+        // Move the tile to the front of the list
+        tiles.splice(tiles.begin(), tiles, it->second);
+        return it->second->second;
+    }
+
+    Mat pixels = imread(tileFile(row, column));
+    if (pixels.empty()) {
+        return pixels;
+    }
+    tiles.emplace_front(number, pixels);
+    tileIndex[number] = tiles.begin();
+    usedBytes += pixels.total() * pixels.elemSize();
+
+    // Evict the least recently used tiles, but keep the one just decoded
+    while (usedBytes > budgetBytes && tiles.size() > 1) {
+        const Mat& evicted = tiles.back().second;
+        usedBytes -= evicted.total() * evicted.elemSize();
+        tileIndex.erase(tiles.back().first);
+        tiles.pop_back();
+    }
+    return pixels;
+}
+
+string TiledImage::tileFile(int row, int column) const {
+    return tilePath + "/" + to_string(row) + "_" + to_string(column) + ".png";
+}
@@ -1,10 +1,26 @@
 // main.cpp
 #include <ImageViewer.h>
+#include <BatchProcessor.h>
 #include <constants.h>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    // Headless mode: project1 --batch <job list> <output directory>
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        if (argc != 4) {
+            std::cerr << "Usage: " << argv[0] << " --batch <job list> <output directory>" << std::endl;
+            return 1;
+        }
+        BatchProcessor batch;
+        if (!batch.loadJobs(argv[2])) {
+            return 1;
+        }
+        return batch.run(argv[3]) == 0 ? 0 : 1;
+    }
 
-int main() {
     ImageViewer viewer;
     viewer.loadImages(constants::dataPath); // Adjust the path as necessary
     viewer.run();
     return 0;
-}
\ No newline at end of file
+}
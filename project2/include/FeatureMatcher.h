@@ -0,0 +1,103 @@
+/**
+ * @file FeatureMatcher.h
+ * @brief This file defines the FeatureMatcher class, which finds point correspondences between images automatically.
+ *
+ * The FeatureMatcher detects ORB or AKAZE keypoints, matches their binary descriptors with a
+ * brute force Hamming matcher and keeps the matches that pass Lowe's ratio test. The features of
+ * the recently matched images are cached, so stepping through a sequence detects every frame once.
+ * Whole sequences are registered in parallel on all cores.
+ */
+
+#ifndef FEATUREMATCHER_H
+#define FEATUREMATCHER_H
+
+#include <opencv2/opencv.hpp>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @struct Registration
+ * @brief The homography between two consecutive frames of a sequence.
+ */
+struct Registration {
+    cv::Mat H; ///< Homography mapping the points of the first frame to the second frame, empty if it failed.
+    int matches = 0; ///< Number of matches that passed the ratio test.
+    int inliers = 0; ///< Number of matches consistent with the homography.
+};
+
+/**
+ * @class FeatureMatcher
+ * @brief Detects and matches keypoints between images.
+ */
+class FeatureMatcher {
+public:
+    /**
+     * @brief Matches the keypoints of two images.
+     * @param file1 The path of the first image, used to cache its features.
+     * @param img1 The first image.
+     * @param file2 The path of the second image, used to cache its features.
+     * @param img2 The second image.
+     * @param pts1 The matched points in the first image.
+     * @param pts2 The matched points in the second image.
+     */
+    void match(const std::string& file1, const cv::Mat& img1, const std::string& file2, const cv::Mat& img2,
+               std::vector<cv::Point2f>& pts1, std::vector<cv::Point2f>& pts2);
+
+    /**
+     * @brief Registers every frame of a sequence to the next one, in parallel.
+     * @param files The paths of the frames in sequence order.
+     * @param sizes Receives the size of every frame if not null, empty for frames that failed to load.
+     * @return The registrations of the consecutive frame pairs, one less than the number of frames.
+     */
+    std::vector<Registration> registerSequence(const std::vector<std::string>& files, std::vector<cv::Size>* sizes = nullptr);
+
+private:
+    /**
+     * @brief The keypoints and descriptors of an image.
+     */
+    struct Features {
+        std::vector<cv::KeyPoint> keypoints; ///< Detected keypoints.
+        cv::Mat descriptors; ///< Binary descriptors of the keypoints, one row per keypoint.
+    };
+    using CachedFeatures = std::pair<std::string, Features>;
+
+    std::list<CachedFeatures> cache; ///< Features of the recently matched images, most recently used first.
+    std::unordered_map<std::string, std::list<CachedFeatures>::iterator> cacheIndex; ///< Maps file paths to cached features.
+
+    /**
+     * @brief Returns the features of an image from the cache, detecting them on a miss.
+     * @param file The path of the image.
+     * @param image The image.
+     * @return The features of the image.
+     */
+    const Features& features(const std::string& file, const cv::Mat& image);
+
+    /**
+     * @brief Creates the configured keypoint detector. Detectors are not shared between threads.
+     * @return The detector.
+     */
+    static cv::Ptr<cv::Feature2D> createDetector();
+
+    /**
+     * @brief Detects the keypoints of an image and computes their descriptors.
+     * @param detector The keypoint detector.
+     * @param image The image, color or grayscale.
+     * @return The features of the image.
+     */
+    static Features detect(cv::Feature2D& detector, const cv::Mat& image);
+
+    /**
+     * @brief Matches two sets of features and applies the ratio test.
+     * @param matcher The descriptor matcher.
+     * @param first The features of the first image.
+     * @param second The features of the second image.
+     * @param pts1 The matched points in the first image.
+     * @param pts2 The matched points in the second image.
+     */
+    static void matchFeatures(cv::DescriptorMatcher& matcher, const Features& first, const Features& second,
+                              std::vector<cv::Point2f>& pts1, std::vector<cv::Point2f>& pts2);
+};
+
+#endif // FEATUREMATCHER_H
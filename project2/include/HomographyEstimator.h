@@ -0,0 +1,125 @@
+/**
+ * @file HomographyEstimator.h
+ * @brief This file defines the HomographyEstimator class, a robust homography estimator based on RANSAC.
+ *
+ * Hypotheses are computed from minimal samples of four correspondences with a fixed-size 8x8 solver
+ * and scored in batches on all cores. The number of iterations adapts to the best inlier ratio found
+ * so far, and the best hypothesis is refitted on all of its inliers with a normalized least squares DLT.
+ * Optionally, the refit is polished with Levenberg-Marquardt iterations on the symmetric transfer error.
+ */
+
+#ifndef HOMOGRAPHYESTIMATOR_H
+#define HOMOGRAPHYESTIMATOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @class HomographyEstimator
+ * @brief Estimates the homography between two sets of corresponding points in the presence of outliers.
+ */
+class HomographyEstimator {
+public:
+    /**
+     * @brief Constructor for the HomographyEstimator class.
+     * @param threshold The maximum reprojection error of an inlier in pixels.
+     * @param confidence The probability that an outlier-free sample is drawn before stopping.
+     * @param maxIterations The maximum number of hypotheses.
+     * @param refineIterations The maximum number of Levenberg-Marquardt iterations after the refit, 0 to skip them.
+     */
+    HomographyEstimator(double threshold, double confidence, int maxIterations, int refineIterations = 0);
+
+    /**
+     * @brief Estimates the homography mapping pts1 to pts2.
+     * @param pts1 The points in the first image.
+     * @param pts2 The corresponding points in the second image.
+     * @param inliers Set to 1 for the correspondences consistent with the homography, 0 otherwise.
+     * @return The 3x3 CV_64F homography, or an empty matrix if no homography was found.
+     */
+    cv::Mat estimate(const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2, std::vector<uchar>& inliers) const;
+
+    /**
+     * @brief Computes the homography through four correspondences, with h33 fixed to 1.
+     * @param src The four points in the first image.
+     * @param dst The four corresponding points in the second image.
+     * @param H The homography mapping src to dst.
+     * @return False if the points are degenerate.
+     */
+    static bool solveMinimal(const cv::Point2f* src, const cv::Point2f* dst, cv::Matx33d& H);
+
+    /**
+     * @brief Fits a homography to the selected correspondences in the least squares sense.
+     *
+     * The coordinates are normalized and the 9x9 normal matrix A^T A of the DLT is accumulated point by point,
+     * so memory does not grow with the number of correspondences.
+     * @param pts1 The points in the first image.
+     * @param pts2 The corresponding points in the second image.
+     * @param selected The correspondences to use, all of them if empty.
+     * @return The 3x3 CV_64F homography, or an empty matrix if fewer than four correspondences are selected.
+     */
+    static cv::Mat fitLeastSquares(const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2,
+                                   const std::vector<uchar>& selected = {});
+
+    /**
+     * @brief Transforms points with a homography and measures their distance to target points, in a single pass.
+     * @param H The homography.
+     * @param src The points to transform.
+     * @param dst The target points, as many as src.
+     * @param squaredErrors Receives the squared distance of every transformed point to its target, FLT_MAX for
+     *        points mapped to infinity.
+     * @param transformed Receives the transformed points if not null, points mapped to infinity become the origin.
+     */
+    static void reprojectionErrors(const cv::Matx33d& H, const std::vector<cv::Point2f>& src, const std::vector<cv::Point2f>& dst,
+                                   float* squaredErrors, cv::Point2f* transformed = nullptr);
+
+    /**
+     * @brief Transforms points with a homography and computes their mean distance to target points.
+     * Points mapped to infinity are left out of the mean.
+     * @param H The homography.
+     * @param src The points to transform.
+     * @param dst The target points.
+     * @param transformed The transformed points.
+     * @return The mean distance, +infinity if every point is mapped to infinity, or -1 if the point sets are
+     *         empty or not of the same size.
+     */
+    static double averageError(const cv::Matx33d& H, const std::vector<cv::Point2f>& src, const std::vector<cv::Point2f>& dst,
+                               std::vector<cv::Point2f>& transformed);
+
+private:
+    double threshold; ///< Maximum reprojection error of an inlier in pixels.
+    double confidence; ///< Probability that an outlier-free sample is drawn before stopping.
+    int maxIterations; ///< Maximum number of hypotheses.
+    int refineIterations; ///< Maximum number of Levenberg-Marquardt iterations after the refit.
+
+    /**
+     * @brief Minimizes the symmetric transfer error of a homography on the selected correspondences
+     *        with Levenberg-Marquardt iterations and an analytic Jacobian.
+     * @param pts1 The points in the first image.
+     * @param pts2 The corresponding points in the second image.
+     * @param selected The correspondences to use.
+     * @param H The homography to refine, replaced by the refined homography.
+     */
+    void refine(const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2, const std::vector<uchar>& selected,
+                cv::Matx33d& H) const;
+
+    /**
+     * @brief Counts the correspondences consistent with a homography.
+     * @param H The homography.
+     * @param pts1 The points in the first image.
+     * @param pts2 The corresponding points in the second image.
+     * @param squaredErrors Scratch buffer for the squared reprojection errors, reused between calls.
+     * @param inliers Set to 1 for the inliers if not null.
+     * @return The number of inliers.
+     */
+    int countInliers(const cv::Matx33d& H, const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2,
+                     std::vector<float>& squaredErrors, std::vector<uchar>* inliers) const;
+
+    /**
+     * @brief Computes the number of iterations needed to draw an outlier-free sample with the configured confidence.
+     * @param inlierRatio The best inlier ratio found so far.
+     * @return The number of iterations, at most the maximum.
+     */
+    int requiredIterations(double inlierRatio) const;
+};
+
+#endif // HOMOGRAPHYESTIMATOR_H
@@ -12,7 +12,15 @@
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
+#include <memory>
 #include <constants.h>
+#include <AsyncImageLoader.h>
+#include <DirectoryIndex.h>
+#include <FeatureMatcher.h>
+#include <HomographyEstimator.h>
+#include <PanoramaStitcher.h>
+#include <Profiler.h>
+#include <WarpCache.h>
 
 /**
  * @class ImageTransformer
@@ -39,11 +47,19 @@ public:
      */
     void run();
 
+    /**
+     * @brief Stitches all loaded images into a panorama without opening a window.
+     * @param outputPath The directory the mosaic tiles are written to.
+     * @return True if the panorama was written.
+     */
+    bool stitch(const std::string& outputPath);
+
 private:
     static constexpr int width = constants::width; ///< Width of the display window.
     static constexpr int height = constants::height; ///< Height of the display window.
     int selectedImage = -1; ///< Index of the currently selected image.
     std::vector<std::string> files; ///< List of image file paths.
+    std::unique_ptr<DirectoryIndex> directory; ///< Live index of the data directory.
 
     cv::Mat img; ///< First image.
     cv::Mat img2; ///< Second image.
@@ -52,13 +68,22 @@ private:
     cv::Mat matchedImage; ///< Resized matched image for display.
     cv::Mat matchedImageCustom; ///< Resized matched image for display.
     cv::Mat grid; ///< Grid to display the images.
+    cv::Mat overlayBuffer; ///< Copy of the grid with the timing overlay drawn on it.
+    Profiler::Clock::time_point requestTime; ///< Time the shown images were requested, for the display latency.
     int N1, N2; ///< Dimensions of the image grid.
     cv::Point2f point1, point2; ///< Points for defining a Region of Interest (ROI).
     std::vector<cv::Point2f> points; ///< Points in the first image.
     std::vector<cv::Point2f> points2; ///< Points in the second image.
     cv::Scalar PointColor; ///< Color for drawing shapes.
     bool firstImageTurn = true; ///< Flag to indicate the turn for the first image.
+    bool autoMatch = false; ///< Flag to use automatically matched keypoints instead of the clicked points.
+    FeatureMatcher matcher; ///< Matcher finding the point correspondences in automatic mode.
+    WarpCache warpCache; ///< Remap tables of the recent homographies, shared by both methods.
     std::string path; ///< Path to the directory containing images.
+    AsyncImageLoader loader; ///< Worker pool decoding the images.
+    std::shared_future<cv::Mat> pendingImage; ///< First image being decoded for display.
+    std::shared_future<cv::Mat> pendingImage2; ///< Second image being decoded for display.
+    int pendingNumber = -1; ///< Number of the image pair being decoded, -1 if none.
 
     /**
      * @brief Displays images in a grid format.
@@ -66,6 +91,34 @@ private:
      */
     void displayImages(int num);
 
+    /**
+     * @brief Shows the pending images in the grid once they are decoded.
+     */
+    void showPendingImages();
+
+    /**
+     * @brief Shows the grid in the window, with the timing overlay if it is enabled.
+     */
+    void showGrid();
+
+    /**
+     * @brief Registers all images of the sequence and writes the homographies to a file.
+     */
+    void registerSequence();
+
+    /**
+     * @brief Draws a placeholder into a grid cell while its image is being decoded.
+     * @param grid The grid where the placeholder will be drawn.
+     * @param position The position in the grid where the placeholder will be drawn.
+     */
+    void drawPlaceholder(cv::Mat &grid, int position);
+
+    /**
+     * @brief Waits for a key press while showing the images that finish decoding.
+     * @return The pressed key.
+     */
+    char waitForKey();
+
     /**
      * @brief Creates a welcome screen with messages.
      * @param messages The messages to display on the welcome screen.
@@ -107,11 +160,9 @@ private:
     void fillGrid(cv::Mat &grid, const cv::Mat &img, int position);
 
     /**
-     * @brief Retrieves the list of files from a specified directory.
-     * @param path The path to the directory.
-     * @return A vector of strings containing the file paths.
+     * @brief Applies the files added to or removed from the data directory to the file list.
      */
-    std::vector<std::string> getFiles(const std::string &path);
+    void refreshFiles();
 
     /**
      * @brief Finds the homography map between two sets of points in two images.
@@ -124,12 +175,14 @@ private:
     cv::Mat findHomographyMap(const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2, const cv::Mat& img1, const cv::Mat& img2);
     
     /**
-     * @brief Calculates the average error between two sets of points.
-     * @param originalPoints The original points.
+     * @brief Transforms points with a homography and calculates their average distance to target points.
+     * @param H The homography.
+     * @param points The points to transform.
+     * @param targets The target points.
      * @param transformedPoints The transformed points.
-     * @return The average error between the two sets of points.
+     * @return The average error between the transformed and target points.
      */
-    double calculateAverageError(const std::vector<cv::Point2f>& originalPoints, const std::vector<cv::Point2f>& transformedPoints);
+    double calculateAverageError(const cv::Mat& H, const std::vector<cv::Point2f>& points, const std::vector<cv::Point2f>& targets, std::vector<cv::Point2f>& transformedPoints);
 
     /**
      * @brief Generates a random color.
@@ -0,0 +1,83 @@
+/**
+ * @file PanoramaStitcher.h
+ * @brief This file defines the PanoramaStitcher class, which blends a whole image sequence into one mosaic.
+ *
+ * The PanoramaStitcher registers every image to the next one in parallel, chains the homographies
+ * into the frame of the middle image and blends the warped images with feathered weights. The mosaic
+ * is written as a grid of tiles. Every image is decoded once, in sequence order, and a tile is written
+ * and freed as soon as the last image overlapping it is blended, so memory is bounded by the tiles
+ * under the images in flight instead of the mosaic size.
+ */
+
+#ifndef PANORAMASTITCHER_H
+#define PANORAMASTITCHER_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <FeatureMatcher.h>
+
+/**
+ * @class PanoramaStitcher
+ * @brief Stitches an image sequence into a tiled mosaic.
+ */
+class PanoramaStitcher {
+public:
+    /**
+     * @brief Stitches the images into a mosaic.
+     * @param files The paths of the images in sequence order.
+     * @param outputPath The directory the tiles, their layout and a preview are written to.
+     * @return True if the mosaic was written.
+     */
+    bool stitch(const std::vector<std::string>& files, const std::string& outputPath);
+
+private:
+    /**
+     * @brief The blending state of a mosaic tile.
+     */
+    struct Tile {
+        cv::Rect rect; ///< Area of the tile in the mosaic.
+        cv::Mat sum; ///< Weighted sum of the blended images, CV_32FC3.
+        cv::Mat weight; ///< Sum of the weights, CV_32F.
+        int lastFrame = -1; ///< Last image overlapping the tile, -1 if none does.
+    };
+
+    FeatureMatcher matcher; ///< Matcher registering the consecutive images.
+    cv::Mat weights; ///< Feathering weights of the last image size.
+
+    /**
+     * @brief Chains the pairwise homographies into homographies to a reference image.
+     * @param registrations The homographies between consecutive images.
+     * @param reference The index of the reference image.
+     * @param transforms The homographies mapping every image to the reference image.
+     * @param placed Set to 0 for the images that are not connected to the reference by successful registrations.
+     */
+    static void chain(const std::vector<Registration>& registrations, int reference,
+                      std::vector<cv::Matx33d>& transforms, std::vector<uchar>& placed);
+
+    /**
+     * @brief Returns the feathering weights of an image, which fall off towards its borders.
+     * @param size The size of the image.
+     * @return The CV_32F weights.
+     */
+    const cv::Mat& featherWeights(cv::Size size);
+
+    /**
+     * @brief Warps an image into a tile and adds it to the weighted sum.
+     * @param tile The tile.
+     * @param frame The image.
+     * @param H The homography mapping the image into the mosaic.
+     * @param frameWeights The feathering weights of the image.
+     */
+    static void blend(Tile& tile, const cv::Mat& frame, const cv::Matx33d& H, const cv::Mat& frameWeights);
+
+    /**
+     * @brief Normalizes a finished tile and writes it to a file.
+     * @param tile The tile.
+     * @param path The path of the file.
+     * @return The blended tile.
+     */
+    static cv::Mat finish(const Tile& tile, const std::string& path);
+};
+
+#endif // PANORAMASTITCHER_H
@@ -0,0 +1,61 @@
+/**
+ * @file Stabilizer.h
+ * @brief This file defines the Stabilizer class, which smooths the camera trajectory of a video.
+ *
+ * The translation, rotation and scale of every frame-to-frame homography are accumulated into a
+ * camera trajectory, which is averaged over a sliding window of past and upcoming frames. The
+ * correction of a frame moves it from its position on the trajectory to the smoothed position.
+ * Only the window is kept, so memory is constant for arbitrarily long videos. Looking ahead delays
+ * every frame by the number of upcoming frames in the window.
+ */
+
+#ifndef STABILIZER_H
+#define STABILIZER_H
+
+#include <opencv2/opencv.hpp>
+#include <deque>
+
+/**
+ * @class Stabilizer
+ * @brief Computes the corrections that cancel the jitter of a video, one frame at a time.
+ */
+class Stabilizer {
+public:
+    /**
+     * @brief Constructor for the Stabilizer class.
+     * @param history The number of past frames in the smoothing window.
+     * @param lookahead The number of upcoming frames in the smoothing window, the delay of the corrections.
+     */
+    Stabilizer(int history, int lookahead);
+
+    /**
+     * @brief Adds the motion of the next frame.
+     * @param H The homography from the previous frame to this frame, empty if there is no previous frame or it failed.
+     * @param correction Receives the correction of the frame lookahead frames back, if there is one.
+     * @return True if a correction was returned.
+     */
+    bool push(const cv::Mat& H, cv::Matx33d& correction);
+
+    /**
+     * @brief Returns the corrections of the frames still waiting for upcoming frames, once the video ended.
+     * @param correction Receives the correction of the oldest waiting frame.
+     * @return False if no frame is waiting.
+     */
+    bool flush(cv::Matx33d& correction);
+
+private:
+    int history; ///< Number of past frames in the smoothing window.
+    int lookahead; ///< Number of upcoming frames in the smoothing window.
+    cv::Vec4d position; ///< Accumulated x and y translation, rotation and log scale of the newest frame.
+    std::deque<cv::Vec4d> trajectory; ///< Positions of the frames in the window, oldest first.
+    int pending = 0; ///< Number of frames at the end of the trajectory without a correction yet.
+
+    /**
+     * @brief Computes the correction of a frame of the trajectory.
+     * @param index The index of the frame in the trajectory.
+     * @return The similarity moving the frame to the smoothed trajectory.
+     */
+    cv::Matx33d correct(int index) const;
+};
+
+#endif // STABILIZER_H
@@ -0,0 +1,121 @@
+/**
+ * @file VideoPipeline.h
+ * @brief This file defines the VideoPipeline class, which runs the frame-to-frame homography on a video or camera.
+ *
+ * Capture, homography estimation and warping run on their own threads, connected by bounded queues,
+ * while the main thread shows the results. Every stage works on a different frame at the same time.
+ * Frames from a live camera are dropped when the estimation falls behind, so the display stays current;
+ * frames from a file are never dropped.
+ *
+ * In stabilization mode the warp stage smooths the camera trajectory and warps every frame to cancel
+ * the jitter instead of showing the frame-to-frame warp.
+ */
+
+#ifndef VIDEOPIPELINE_H
+#define VIDEOPIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <BoundedQueue.h>
+#include <FeatureMatcher.h>
+#include <Profiler.h>
+
+/**
+ * @class VideoPipeline
+ * @brief Estimates and shows the homography between consecutive frames of a video stream.
+ */
+class VideoPipeline {
+public:
+    /**
+     * @brief Constructor for the VideoPipeline class.
+     * @param stabilize Whether to stabilize the video instead of showing the frame-to-frame warp.
+     */
+    explicit VideoPipeline(bool stabilize = false);
+
+    /**
+     * @brief Opens a video file or a camera.
+     * @param source The path of a video file, a device such as /dev/video0, or a camera index.
+     * @return True if the source was opened.
+     */
+    bool open(const std::string& source);
+
+    /**
+     * @brief Processes the stream until it ends or 'q' is pressed.
+     */
+    void run();
+
+private:
+    /**
+     * @brief A captured frame.
+     */
+    struct Frame {
+        int index = -1; ///< Number of the frame in the stream.
+        cv::Mat image; ///< The frame.
+        Profiler::Clock::time_point captured; ///< Time the frame was captured, for the display latency.
+    };
+
+    /**
+     * @brief A frame together with the homography from the previous frame.
+     */
+    struct Estimate {
+        Frame frame; ///< The current frame.
+        cv::Mat previous; ///< The previous frame, empty for the first frame.
+        cv::Mat H; ///< Homography mapping the previous frame to the current frame, empty if it failed.
+        int inliers = 0; ///< Number of matches consistent with the homography.
+    };
+
+    /**
+     * @brief A frame ready to be shown.
+     */
+    struct Output {
+        Frame frame; ///< The current frame.
+        cv::Mat view; ///< The image to show.
+    };
+
+    cv::VideoCapture capture; ///< The opened video source.
+    bool live = false; ///< Whether the source is a camera, whose frames may be dropped.
+    bool stabilize; ///< Whether to stabilize the video instead of showing the frame-to-frame warp.
+    FeatureMatcher matcher; ///< Matcher of the consecutive frames, used by the estimation thread only.
+    BoundedQueue<Frame> frames; ///< Captured frames waiting for the estimation.
+    BoundedQueue<Estimate> estimates; ///< Estimated frames waiting for the warp.
+    BoundedQueue<Output> outputs; ///< Warped frames waiting for the display.
+    std::atomic<int> dropped{0}; ///< Number of camera frames dropped because the estimation fell behind.
+    cv::Mat overlayBuffer; ///< Copy of the view with the timing overlay drawn on it.
+
+    /**
+     * @brief Reads frames from the source until it ends or the pipeline stops.
+     */
+    void captureLoop();
+
+    /**
+     * @brief Matches every frame to the previous one and estimates their homography.
+     */
+    void estimateLoop();
+
+    /**
+     * @brief Warps the previous frame onto the current one and composes the view.
+     */
+    void warpLoop();
+
+    /**
+     * @brief Smooths the camera trajectory and warps every frame onto it, delayed by the stabilizer lookahead.
+     */
+    void stabilizeLoop();
+
+    /**
+     * @brief Warps a frame with its stabilizing correction and queues it next to the original frame.
+     * @param frame The frame.
+     * @param correction The correction of the frame.
+     * @return False if the pipeline stopped.
+     */
+    bool showStabilized(Frame frame, const cv::Matx33d& correction);
+
+    /**
+     * @brief Closes all queues, which stops every stage.
+     */
+    void stop();
+};
+
+#endif // VIDEOPIPELINE_H
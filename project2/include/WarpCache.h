@@ -0,0 +1,57 @@
+/**
+ * @file WarpCache.h
+ * @brief This file defines the WarpCache class, which applies perspective warps from cached remap tables.
+ *
+ * warpPerspective recomputes the source position of every pixel on each call. The WarpCache computes
+ * these positions once per homography, output size and interpolation, stores them as fixed-point
+ * remap tables, and applies them with remap. Warping many frames with the same homography, as with
+ * a fixed camera, then costs about one pass over the image.
+ */
+
+#ifndef WARPCACHE_H
+#define WARPCACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <list>
+
+/**
+ * @class WarpCache
+ * @brief Warps images with homographies, reusing the remap tables of recently used homographies.
+ */
+class WarpCache {
+public:
+    /**
+     * @brief Warps an image like cv::warpPerspective with a constant black border.
+     * @param src The image to warp.
+     * @param dst The warped image.
+     * @param H The homography mapping the source to the destination image.
+     * @param size The size of the destination image.
+     * @param interpolation The interpolation method.
+     */
+    void warp(const cv::Mat& src, cv::Mat& dst, const cv::Mat& H, cv::Size size, int interpolation = cv::INTER_LINEAR);
+
+private:
+    /**
+     * @brief The remap tables of a homography.
+     */
+    struct Maps {
+        cv::Matx33d H; ///< Homography the tables were computed for.
+        cv::Size size; ///< Size of the destination image.
+        int interpolation; ///< Interpolation method.
+        cv::Mat map1; ///< Integer source positions, CV_16SC2.
+        cv::Mat map2; ///< Interpolation table indices of the fractional positions, CV_16UC1, empty for INTER_NEAREST.
+    };
+
+    std::list<Maps> cache; ///< Recently used remap tables, most recently used first.
+
+    /**
+     * @brief Returns the remap tables of a homography from the cache, computing them on a miss.
+     * @param H The homography mapping the source to the destination image.
+     * @param size The size of the destination image.
+     * @param interpolation The interpolation method.
+     * @return The remap tables.
+     */
+    const Maps& maps(const cv::Matx33d& H, cv::Size size, int interpolation);
+};
+
+#endif // WARPCACHE_H
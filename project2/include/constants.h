@@ -2,13 +2,42 @@
 #define CONSTANTS_H
 
 #include <string>
+#include <vector>
+#include <CommonConstants.h>
 namespace constants {
     const std::string dataPath = "../Data/corridor_human2";
     constexpr int width = 192;
     constexpr int height = 108;
-    const std::vector<std::string> welcomeMessage = {"Welcome to the Homogrophic Transformer!","Write the image number and press Enter to display the image.","Press 'q' to quit.","By clicking on the images you can select points to use in transformation", "Then press enter", "Custom method result is on top, built-in method result is at the bottom" ,"Prepared by: Ahmet Furkan Akinci"};
+    const std::vector<std::string> welcomeMessage = {"Welcome to the Homogrophic Transformer!","Write the image number and press Enter to display the image.","Press 'q' to quit.","Press 'h' for stage timings, 't' to save them as a trace","By clicking on the images you can select points to use in transformation", "Then press enter", "Press 'm' to match points automatically, 'r' to register the whole sequence", "Custom method result is on top, built-in method result is at the bottom" ,"Prepared by: Ahmet Furkan Akinci"};
     const int circleRadius = 6;
     const int lineThickness = 4;
+    constexpr int pollDelay = 15; // Milliseconds to wait for a key press before checking pending decodes
+    const std::string featureType = "ORB"; // Keypoint detector of the automatic matching, "ORB" or "AKAZE"
+    constexpr int maxFeatures = 2000; // Number of ORB keypoints detected per image
+    constexpr float ratioTest = 0.75f; // Maximum ratio between the best and second best match distance
+    constexpr size_t featureCacheSize = 4; // Number of images whose features are kept for matching
+    constexpr double ransacThreshold = 3.0; // Maximum reprojection error of a RANSAC inlier in pixels
+    constexpr double ransacConfidence = 0.995; // Probability of drawing an outlier-free sample before RANSAC stops
+    constexpr int ransacMaxIterations = 2000; // Maximum number of RANSAC hypotheses
+    constexpr int ransacBatchSize = 64; // Number of RANSAC hypotheses scored in parallel between stopping checks
+    constexpr int refineIterations = 10; // Levenberg-Marquardt iterations polishing the custom homography, 0 to skip them
+    constexpr size_t warpCacheSize = 4; // Number of homographies whose remap tables are kept for warping
+    const std::string registrationFile = "registration.txt"; // Homographies written when 'r' is pressed
+    constexpr int panoramaTileSize = 1024; // Side length of the mosaic tiles written by --stitch
+    constexpr int panoramaMaxSize = 50000; // Largest mosaic side in pixels, larger mosaics mean the registration drifted
+    constexpr int panoramaPreviewSize = 4096; // Longest side of the downscaled mosaic preview
+    constexpr size_t panoramaPrefetch = 4; // Number of images decoded ahead of the blending
+    const std::string panoramaLayoutFile = "panorama.txt"; // Mosaic and tile sizes written next to the tiles
+    const std::string panoramaPreviewFile = "preview.jpg"; // Downscaled mosaic written next to the tiles
+    constexpr size_t videoQueueSize = 4; // Frames buffered between the capture, estimation, warp and display threads
+    constexpr int videoEstimationWidth = 640; // Wider video frames are downscaled to this width for matching
+    constexpr int stabilizationHistory = 30; // Past frames in the trajectory smoothing window
+    constexpr int stabilizationLookahead = 5; // Upcoming frames in the smoothing window, the delay of the stabilized video
+    constexpr double stabilizationZoom = 1.1; // Zoom of the stabilized frames, hides the uncovered borders
+    const std::string benchmarkFile = "benchmark.csv"; // Results written by the benchmark target
+    constexpr int benchmarkRuns = 20; // Estimates per estimator and configuration in the benchmark
+    const std::string loadingMessage = "Loading...";
+    const std::string traceFile = "trace.json"; // Chrome trace written when 't' is pressed
 }
 
 #endif // CONSTANTS_H
\ No newline at end of file
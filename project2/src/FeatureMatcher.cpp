@@ -0,0 +1,123 @@
+#include <FeatureMatcher.h>
+#include <HomographyEstimator.h>
+#include <Profiler.h>
+#include <constants.h>
+
+using namespace cv;
+using namespace std;
+
+void FeatureMatcher::match(const string& file1, const Mat& img1, const string& file2, const Mat& img2,
+                           vector<Point2f>& pts1, vector<Point2f>& pts2) {
+    // The cache holds at least two images, so both references stay valid
+    static_assert(constants::featureCacheSize >= 2);
+    const Features& first = features(file1, img1);
+    const Features& second = features(file2, img2);
+    BFMatcher matcher(NORM_HAMMING);
+    matchFeatures(matcher, first, second, pts1, pts2);
+}
+
+vector<Registration> FeatureMatcher::registerSequence(const vector<string>& files, vector<Size>* sizes) {
+    if (sizes) {
+        sizes->assign(files.size(), Size());
+    }
+    if (files.size() < 2) {
+        return {};
+    }
+
+    // Decode and detect every frame once, each thread uses its own detector
+    vector<Features> frames(files.size());
+    parallel_for_(Range(0, files.size()), [&](const Range& range) {
+        Ptr<Feature2D> detector = createDetector();
+        for (int i = range.start; i < range.end; i++) {
+            Mat image = imread(files[i], IMREAD_GRAYSCALE);
+            if (!image.empty()) {
+                frames[i] = detect(*detector, image);
+                if (sizes) {
+                    (*sizes)[i] = image.size();
+                }
+            }
+        }
+    });
+
+    // Match the consecutive frames and estimate their homographies
+    vector<Registration> registrations(files.size() - 1);
+    HomographyEstimator estimator(constants::ransacThreshold, constants::ransacConfidence, constants::ransacMaxIterations,
+                                  constants::refineIterations);
+    parallel_for_(Range(0, registrations.size()), [&](const Range& range) {
+        BFMatcher matcher(NORM_HAMMING);
+        for (int i = range.start; i < range.end; i++) {
+            vector<Point2f> pts1, pts2;
+            matchFeatures(matcher, frames[i], frames[i + 1], pts1, pts2);
+            Registration& registration = registrations[i];
+            registration.matches = pts1.size();
+            if (pts1.size() < 4) {
+                continue;
+            }
+            vector<uchar> inliers;
+            registration.H = estimator.estimate(pts1, pts2, inliers);
+            registration.inliers = registration.H.empty() ? 0 : countNonZero(inliers);
+        }
+    });
+    return registrations;
+}
+
+const FeatureMatcher::Features& FeatureMatcher::features(const string& file, const Mat& image) {
+    auto it = cacheIndex.find(file);
+    if (it != cacheIndex.end()) {
+        // Move the features to the front of the list
+        cache.splice(cache.begin(), cache, it->second);
+        return it->second->second;
+    }
+
+    Features detected;
+    {
+        ScopedTimer timer("feature detection");
+        Ptr<Feature2D> detector = createDetector();
+        detected = detect(*detector, image);
+    }
+    cache.emplace_front(file, std::move(detected));
+    cacheIndex[file] = cache.begin();
+    if (cache.size() > constants::featureCacheSize) {
+        cacheIndex.erase(cache.back().first);
+        cache.pop_back();
+    }
+    return cache.front().second;
+}
+
+Ptr<Feature2D> FeatureMatcher::createDetector() {
+    if (constants::featureType == "AKAZE") {
+        return AKAZE::create();
+    }
+    return ORB::create(constants::maxFeatures);
+}
+
+FeatureMatcher::Features FeatureMatcher::detect(Feature2D& detector, const Mat& image) {
+    Mat gray;
+    if (image.channels() == 3) {
+        cvtColor(image, gray, COLOR_BGR2GRAY);
+    } else {
+        gray = image;
+    }
+    Features features;
+    detector.detectAndCompute(gray, noArray(), features.keypoints, features.descriptors);
+    return features;
+}
+
+void FeatureMatcher::matchFeatures(DescriptorMatcher& matcher, const Features& first, const Features& second,
+                                   vector<Point2f>& pts1, vector<Point2f>& pts2) {
+    pts1.clear();
+    pts2.clear();
+    if (first.descriptors.rows < 2 || second.descriptors.rows < 2) {
+        return;
+    }
+    ScopedTimer timer("feature matching");
+    vector<vector<DMatch>> knnMatches;
+    matcher.knnMatch(first.descriptors, second.descriptors, knnMatches, 2);
+    for (const auto& candidates : knnMatches) {
+        // Keep a match only if it is clearly better than the second best candidate
+        if (candidates.size() == 2 && candidates[0].distance < constants::ratioTest * candidates[1].distance) {
+            pts1.push_back(first.keypoints[candidates[0].queryIdx].pt);
+            pts2.push_back(second.keypoints[candidates[0].trainIdx].pt);
+        }
+    }
+}
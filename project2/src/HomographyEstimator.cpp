@@ -0,0 +1,402 @@
+#include <HomographyEstimator.h>
+#include <constants.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Checks whether three points are (almost) on a line.
+ */
+bool collinear(const Point2f& a, const Point2f& b, const Point2f& c) {
+    Point2d ab = Point2d(b) - Point2d(a), ac = Point2d(c) - Point2d(a);
+    return std::abs(ab.cross(ac)) <= 1e-6 * norm(ab) * norm(ac);
+}
+
+/**
+ * @brief Computes the similarity that moves the centroid of the points to the origin and their mean distance to sqrt(2).
+ */
+Matx33d normalization(const vector<Point2f>& pts, const vector<uchar>& selected) {
+    Point2d centroid(0, 0);
+    int count = 0;
+    for (size_t i = 0; i < pts.size(); i++) {
+        if (selected.empty() || selected[i]) {
+            centroid += Point2d(pts[i]);
+            count++;
+        }
+    }
+    centroid *= 1.0 / count;
+    double distance = 0;
+    for (size_t i = 0; i < pts.size(); i++) {
+        if (selected.empty() || selected[i]) {
+            distance += norm(Point2d(pts[i]) - centroid);
+        }
+    }
+    double scale = distance > 0 ? std::sqrt(2.0) * count / distance : 1.0;
+    return Matx33d(scale, 0, -scale * centroid.x,
+                   0, scale, -scale * centroid.y,
+                   0, 0, 1);
+}
+
+/**
+ * @brief Computes the symmetric transfer error of a homography in normalized coordinates and,
+ *        if requested, the Gauss-Newton normal equations of its eight free entries (h33 is fixed to 1).
+ */
+double symmetricTransferError(const Matx33d& H, const Matx33d& T1, const Matx33d& T2,
+                              const vector<Point2f>& pts1, const vector<Point2f>& pts2, const vector<uchar>& selected,
+                              Matx<double, 8, 8>* JtJ, Vec<double, 8>* Jtr) {
+    Matx33d G = H.inv();
+    if (JtJ) {
+        *JtJ = Matx<double, 8, 8>::zeros();
+        *Jtr = Vec<double, 8>();
+    }
+    double error = 0;
+    double Jf[2][8], Jb[2][8];
+    for (size_t i = 0; i < pts1.size(); i++) {
+        if (!selected[i]) {
+            continue;
+        }
+        Vec3d x(T1(0, 0) * pts1[i].x + T1(0, 2), T1(1, 1) * pts1[i].y + T1(1, 2), 1);
+        Vec3d xp(T2(0, 0) * pts2[i].x + T2(0, 2), T2(1, 1) * pts2[i].y + T2(1, 2), 1);
+        Vec3d p = H * x, q = G * xp;
+        if (std::abs(p[2]) < DBL_EPSILON || std::abs(q[2]) < DBL_EPSILON) {
+            continue;
+        }
+        // Forward residual H x - x' and backward residual H^-1 x' - x
+        double rf[2] = {p[0] / p[2] - xp[0], p[1] / p[2] - xp[1]};
+        double rb[2] = {q[0] / q[2] - x[0], q[1] / q[2] - x[1]};
+        error += rf[0] * rf[0] + rf[1] * rf[1] + rb[0] * rb[0] + rb[1] * rb[1];
+        if (!JtJ) {
+            continue;
+        }
+
+        // Derivatives of the perspective division at p and q
+        double Jp[2][3] = {{1 / p[2], 0, -p[0] / (p[2] * p[2])}, {0, 1 / p[2], -p[1] / (p[2] * p[2])}};
+        double Jq[2][3] = {{1 / q[2], 0, -q[0] / (q[2] * q[2])}, {0, 1 / q[2], -q[1] / (q[2] * q[2])}};
+        for (int k = 0; k < 8; k++) {
+            int r = k / 3, c = k % 3;
+            for (int a = 0; a < 2; a++) {
+                // d(H x)/dh_rc = e_r x_c, and d(H^-1 x')/dh_rc = -H^-1 e_r e_c^T H^-1 x' = -G.col(r) q_c
+                Jf[a][k] = Jp[a][r] * x[c];
+                Jb[a][k] = -(Jq[a][0] * G(0, r) + Jq[a][1] * G(1, r) + Jq[a][2] * G(2, r)) * q[c];
+            }
+        }
+        for (int u = 0; u < 8; u++) {
+            for (int v = u; v < 8; v++) {
+                (*JtJ)(u, v) += Jf[0][u] * Jf[0][v] + Jf[1][u] * Jf[1][v] + Jb[0][u] * Jb[0][v] + Jb[1][u] * Jb[1][v];
+            }
+            (*Jtr)[u] += Jf[0][u] * rf[0] + Jf[1][u] * rf[1] + Jb[0][u] * rb[0] + Jb[1][u] * rb[1];
+        }
+    }
+    if (JtJ) {
+        for (int u = 1; u < 8; u++) {
+            for (int v = 0; v < u; v++) {
+                (*JtJ)(u, v) = (*JtJ)(v, u);
+            }
+        }
+    }
+    return error;
+}
+
+} // namespace
+
+HomographyEstimator::HomographyEstimator(double threshold, double confidence, int maxIterations, int refineIterations)
+    : threshold(threshold), confidence(confidence), maxIterations(maxIterations), refineIterations(refineIterations) {}
+
+Mat HomographyEstimator::estimate(const vector<Point2f>& pts1, const vector<Point2f>& pts2, vector<uchar>& inliers) const {
+    inliers.assign(pts1.size(), 0);
+    const int n = pts1.size();
+    if (n < 4 || pts1.size() != pts2.size()) {
+        return Mat();
+    }
+
+    Matx33d best;
+    int bestCount = 0;
+    int iterations = 0;
+    int required = maxIterations;
+    while (iterations < required) {
+        // Hypotheses are drawn and scored in batches on all cores, the stopping criterion is updated between batches
+        int batch = min(constants::ransacBatchSize, required - iterations);
+        vector<Matx33d> hypotheses(batch);
+        vector<int> counts(batch, 0);
+        parallel_for_(Range(0, batch), [&](const Range& range) {
+            Point2f src[4], dst[4];
+            vector<float> squaredErrors;
+            for (int j = range.start; j < range.end; j++) {
+                // Seed every hypothesis by its number, so the result does not depend on the thread count
+                RNG rng((uint64)(iterations + j + 1) * 0x9E3779B97F4A7C15ULL);
+                int sample[4];
+                for (int k = 0; k < 4; k++) {
+                    do {
+                        sample[k] = rng.uniform(0, n);
+                    } while (find(sample, sample + k, sample[k]) != sample + k);
+                    src[k] = pts1[sample[k]];
+                    dst[k] = pts2[sample[k]];
+                }
+                if (solveMinimal(src, dst, hypotheses[j])) {
+                    counts[j] = countInliers(hypotheses[j], pts1, pts2, squaredErrors, nullptr);
+                }
+            }
+        });
+        iterations += batch;
+
+        int j = max_element(counts.begin(), counts.end()) - counts.begin();
+        if (counts[j] > bestCount) {
+            bestCount = counts[j];
+            best = hypotheses[j];
+            required = requiredIterations(double(bestCount) / n);
+        }
+    }
+    if (bestCount < 4) {
+        return Mat();
+    }
+
+    // Refit on all inliers of the best hypothesis, keep the refit only if it does not lose inliers
+    vector<float> squaredErrors;
+    countInliers(best, pts1, pts2, squaredErrors, &inliers);
+    Mat refit = fitLeastSquares(pts1, pts2, inliers);
+    if (!refit.empty()) {
+        vector<uchar> refitInliers;
+        int refitCount = countInliers(Matx33d(refit), pts1, pts2, squaredErrors, &refitInliers);
+        if (refitCount >= bestCount) {
+            inliers.swap(refitInliers);
+            best = Matx33d(refit);
+            bestCount = refitCount;
+        }
+    }
+
+    // The DLT minimizes an algebraic error, polish the result on the geometric error of the same inliers
+    if (refineIterations > 0) {
+        Matx33d refined = best;
+        refine(pts1, pts2, inliers, refined);
+        vector<uchar> refinedInliers;
+        if (countInliers(refined, pts1, pts2, squaredErrors, &refinedInliers) >= bestCount) {
+            inliers.swap(refinedInliers);
+            best = refined;
+        }
+    }
+    return Mat(best, true);
+}
+
+void HomographyEstimator::refine(const vector<Point2f>& pts1, const vector<Point2f>& pts2, const vector<uchar>& selected,
+                                 Matx33d& H) const {
+    if (countNonZero(selected) < 4) {
+        return;
+    }
+    // Refine in normalized coordinates, where the entries of H have comparable magnitudes
+    Matx33d T1 = normalization(pts1, selected);
+    Matx33d T2 = normalization(pts2, selected);
+    Matx33d Hn = T2 * H * T1.inv();
+    if (std::abs(Hn(2, 2)) < DBL_EPSILON) {
+        return;
+    }
+    Hn *= 1.0 / Hn(2, 2);
+
+    Matx<double, 8, 8> JtJ, candidateJtJ;
+    Vec<double, 8> Jtr, candidateJtr, delta;
+    double error = symmetricTransferError(Hn, T1, T2, pts1, pts2, selected, &JtJ, &Jtr);
+    double lambda = 1e-3;
+    for (int iteration = 0; iteration < refineIterations && error > 0; iteration++) {
+        // Damp the Gauss-Newton step, more strongly after steps that increased the error
+        Matx<double, 8, 8> A = JtJ;
+        for (int k = 0; k < 8; k++) {
+            A(k, k) += lambda * JtJ(k, k) + DBL_EPSILON;
+        }
+        Vec<double, 8> rhs = Jtr * -1.0;
+        if (!solve(A, rhs, delta, DECOMP_CHOLESKY)) {
+            lambda *= 10;
+            continue;
+        }
+        Matx33d candidate = Hn;
+        for (int k = 0; k < 8; k++) {
+            candidate(k / 3, k % 3) += delta[k];
+        }
+        double candidateError = symmetricTransferError(candidate, T1, T2, pts1, pts2, selected, &candidateJtJ, &candidateJtr);
+        if (candidateError >= error) {
+            lambda *= 10;
+            continue;
+        }
+        bool converged = error - candidateError < 1e-10 * error;
+        Hn = candidate;
+        error = candidateError;
+        JtJ = candidateJtJ;
+        Jtr = candidateJtr;
+        lambda = max(lambda / 10, 1e-12);
+        if (converged) {
+            break;
+        }
+    }
+
+    Matx33d refined = T2.inv() * Hn * T1;
+    if (std::abs(refined(2, 2)) > DBL_EPSILON) {
+        H = refined * (1.0 / refined(2, 2));
+    }
+}
+
+bool HomographyEstimator::solveMinimal(const Point2f* src, const Point2f* dst, Matx33d& H) {
+    // Reject samples with three points on a line, or whose triangles change orientation
+    static const int triangles[4][3] = {{0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3}};
+    for (const auto& t : triangles) {
+        if (collinear(src[t[0]], src[t[1]], src[t[2]]) || collinear(dst[t[0]], dst[t[1]], dst[t[2]])) {
+            return false;
+        }
+        double srcArea = (src[t[1]] - src[t[0]]).cross(src[t[2]] - src[t[0]]);
+        double dstArea = (dst[t[1]] - dst[t[0]]).cross(dst[t[2]] - dst[t[0]]);
+        if ((srcArea > 0) != (dstArea > 0)) {
+            return false;
+        }
+    }
+
+    // Each correspondence gives two linear equations in the remaining eight entries
+    Matx<double, 8, 8> A;
+    Vec<double, 8> b, h;
+    for (int i = 0; i < 4; i++) {
+        double x = src[i].x, y = src[i].y;
+        double u = dst[i].x, v = dst[i].y;
+        double rowU[8] = {x, y, 1, 0, 0, 0, -x * u, -y * u};
+        double rowV[8] = {0, 0, 0, x, y, 1, -x * v, -y * v};
+        for (int k = 0; k < 8; k++) {
+            A(2 * i, k) = rowU[k];
+            A(2 * i + 1, k) = rowV[k];
+        }
+        b[2 * i] = u;
+        b[2 * i + 1] = v;
+    }
+    if (!solve(A, b, h, DECOMP_LU)) {
+        return false;
+    }
+    H = Matx33d(h[0], h[1], h[2],
+                h[3], h[4], h[5],
+                h[6], h[7], 1);
+    return true;
+}
+
+Mat HomographyEstimator::fitLeastSquares(const vector<Point2f>& pts1, const vector<Point2f>& pts2, const vector<uchar>& selected) {
+    int count = selected.empty() ? pts1.size() : countNonZero(selected);
+    if (count < 4 || pts1.size() != pts2.size()) {
+        return Mat();
+    }
+
+    // Normalize both point sets so that the DLT is well conditioned
+    Matx33d T1 = normalization(pts1, selected);
+    Matx33d T2 = normalization(pts2, selected);
+
+    // Accumulate the upper triangle of A^T A one correspondence at a time instead of building the 2Nx9 A
+    Matx<double, 9, 9> AtA = Matx<double, 9, 9>::zeros();
+    for (size_t i = 0; i < pts1.size(); i++) {
+        if (!selected.empty() && !selected[i]) {
+            continue;
+        }
+        double x = T1(0, 0) * pts1[i].x + T1(0, 2), y = T1(1, 1) * pts1[i].y + T1(1, 2);
+        double u = T2(0, 0) * pts2[i].x + T2(0, 2), v = T2(1, 1) * pts2[i].y + T2(1, 2);
+        const double rowU[9] = {-x, -y, -1, 0, 0, 0, x * u, y * u, u};
+        const double rowV[9] = {0, 0, 0, -x, -y, -1, x * v, y * v, v};
+        for (int r = 0; r < 9; r++) {
+            for (int c = r; c < 9; c++) {
+                AtA(r, c) += rowU[r] * rowU[c] + rowV[r] * rowV[c];
+            }
+        }
+    }
+    for (int r = 1; r < 9; r++) {
+        for (int c = 0; c < r; c++) {
+            AtA(r, c) = AtA(c, r);
+        }
+    }
+
+    // The solution is the eigenvector of the smallest eigenvalue, eigenvalues are sorted in descending order
+    Mat eigenvalues, eigenvectors;
+    if (!eigen(AtA, eigenvalues, eigenvectors)) {
+        return Mat();
+    }
+    Matx33d Hn(eigenvectors.ptr<double>(8));
+    Matx33d H = T2.inv() * Hn * T1;
+    if (std::abs(H(2, 2)) < DBL_EPSILON) {
+        return Mat();
+    }
+    H *= 1.0 / H(2, 2);
+    return Mat(H, true);
+}
+
+void HomographyEstimator::reprojectionErrors(const Matx33d& H, const vector<Point2f>& src, const vector<Point2f>& dst,
+                                             float* squaredErrors, Point2f* transformed) {
+    // Plain float arithmetic without branches in the loop, so the compiler vectorizes it
+    const float h00 = H(0, 0), h01 = H(0, 1), h02 = H(0, 2);
+    const float h10 = H(1, 0), h11 = H(1, 1), h12 = H(1, 2);
+    const float h20 = H(2, 0), h21 = H(2, 1), h22 = H(2, 2);
+    const int n = src.size();
+    const Point2f* s = src.data();
+    const Point2f* d = dst.data();
+    for (int i = 0; i < n; i++) {
+        float x = s[i].x, y = s[i].y;
+        float w = h20 * x + h21 * y + h22;
+        // Points mapped to infinity are transformed to the origin like perspectiveTransform does, and never match
+        bool finite = std::abs(w) > FLT_EPSILON;
+        float iw = finite ? 1.f / w : 0.f;
+        float u = (h00 * x + h01 * y + h02) * iw;
+        float v = (h10 * x + h11 * y + h12) * iw;
+        float dx = u - d[i].x, dy = v - d[i].y;
+        float error2 = finite ? dx * dx + dy * dy : FLT_MAX;
+        squaredErrors[i] = error2;
+        if (transformed) {
+            transformed[i] = Point2f(u, v);
+        }
+    }
+}
+
+double HomographyEstimator::averageError(const Matx33d& H, const vector<Point2f>& src, const vector<Point2f>& dst,
+                                         vector<Point2f>& transformed) {
+    if (src.size() != dst.size() || src.empty()) {
+        transformed.clear();
+        return -1.0;
+    }
+    vector<float> squaredErrors(src.size());
+    transformed.resize(src.size());
+    reprojectionErrors(H, src, dst, squaredErrors.data(), transformed.data());
+    double total = 0;
+    int counted = 0;
+    for (float error2 : squaredErrors) {
+        // Points mapped to infinity have no distance, their FLT_MAX marker is skipped
+        if (error2 == FLT_MAX) {
+            continue;
+        }
+        total += std::sqrt(error2);
+        counted++;
+    }
+    return counted > 0 ? total / counted : numeric_limits<double>::infinity();
+}
+
+int HomographyEstimator::countInliers(const Matx33d& H, const vector<Point2f>& pts1, const vector<Point2f>& pts2,
+                                      vector<float>& squaredErrors, vector<uchar>* inliers) const {
+    squaredErrors.resize(pts1.size());
+    reprojectionErrors(H, pts1, pts2, squaredErrors.data(), nullptr);
+    const float threshold2 = threshold * threshold;
+    int count = 0;
+    for (float error2 : squaredErrors) {
+        count += error2 <= threshold2;
+    }
+    if (inliers) {
+        inliers->resize(pts1.size());
+        for (size_t i = 0; i < pts1.size(); i++) {
+            (*inliers)[i] = squaredErrors[i] <= threshold2;
+        }
+    }
+    return count;
+}
+
+int HomographyEstimator::requiredIterations(double inlierRatio) const {
+    // Probability that a sample of four correspondences contains only inliers
+    double p = pow(inlierRatio, 4);
+    if (p <= DBL_EPSILON) {
+        return maxIterations;
+    }
+    if (p >= 1 - DBL_EPSILON) {
+        return 1;
+    }
+    double n = log(1 - confidence) / log(1 - p);
+    return n < maxIterations ? max(1, (int)ceil(n)) : maxIterations;
+}
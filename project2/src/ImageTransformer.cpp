@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <constants.h>
 #include <algorithm>
+#include <fstream>
 
 using namespace cv;
 using namespace std;
@@ -10,7 +11,9 @@ using namespace std;
 ImageTransformer::ImageTransformer() : N1(0), N2(0) {}
 
 void ImageTransformer::loadImages(const string& path) {
-    files = getFiles(path);
+    // Scan the directory once, later changes are applied by refreshFiles
+    directory = make_unique<DirectoryIndex>(path, [this](const string& file) { return extractNumber(file); });
+    files = directory->files();
     
     if (!files.empty()) {
         // Assuming the first file is the target
@@ -41,35 +44,121 @@ void ImageTransformer::displayImages(int num) {
             cerr << "Invalid image number." << endl;
             return;
         }
-        img = imread(files[num-1]);
-        img2 = imread(files[num]);
+        // Decode jobs of the previously selected images are stale now
+        loader.cancelPending();
+        requestTime = Profiler::Clock::now();
+        pendingNumber = num;
+        pendingImage = loader.load(files[num-1]);
+        pendingImage2 = loader.load(files[num]);
+
+        drawPlaceholder(grid, 0);
+        drawPlaceholder(grid, 1);
+        showGrid();
+    }
+}
 
-        if (img.empty() || img2.empty()) {
-            cerr << "Failed to load image." << endl;
-            return;
-        }
-        // Resize for display if necessary
-        displayImage = img.clone();
-        displayImage2 = img2.clone();
-        // Check if points are available
-        if (points.size() == points2.size() && points.size() > 3) {
+void ImageTransformer::showPendingImages() {
+    if (pendingNumber == -1 || !AsyncImageLoader::isReady(pendingImage) || !AsyncImageLoader::isReady(pendingImage2)) {
+        return;
+    }
+    img = pendingImage.get();
+    img2 = pendingImage2.get();
+    int number = pendingNumber;
+    pendingNumber = -1;
+
+    if (img.empty() || img2.empty()) {
+        cerr << "Failed to load image." << endl;
+        return;
+    }
+    // Resize for display if necessary
+    displayImage = img.clone();
+    displayImage2 = img2.clone();
+    // Replace the clicked points by matched keypoints in automatic mode
+    if (autoMatch) {
+        matcher.match(files[number-1], img, files[number], img2, points, points2);
+        cout << "Matched points: " << points.size() << endl;
+    }
+    // Check if points are available
+    if (points.size() == points2.size() && points.size() > 3) {
+        {
+            ScopedTimer timer("homography (built-in)");
             matchedImage = findHomographyMap(points, points2, img, img2);
+        }
+        {
+            ScopedTimer timer("homography (custom)");
             matchedImageCustom = computeHomography(points, points2, img, img2);
-            fillGrid(grid, matchedImageCustom, 0);
-            fillGrid(grid, matchedImage, 2);
-        } else {
-            cv::Mat blackImage = Mat::zeros(N1, N2, img.type());
-            fillGrid(grid, displayImage, 0);
-            fillGrid(grid, displayImage2, 1);
-            fillGrid(grid, blackImage, 2);
-            fillGrid(grid, blackImage, 3);
-        }    
-        points.clear();
-        points2.clear();
-        firstImageTurn = true;
+        }
+        ScopedTimer timer("composite");
+        fillGrid(grid, matchedImageCustom, 0);
+        fillGrid(grid, matchedImage, 2);
+    } else {
+        ScopedTimer timer("composite");
+        cv::Mat blackImage = Mat::zeros(N1, N2, img.type());
+        fillGrid(grid, displayImage, 0);
+        fillGrid(grid, displayImage2, 1);
+        fillGrid(grid, blackImage, 2);
+        fillGrid(grid, blackImage, 3);
+    }    
+    points.clear();
+    points2.clear();
+    firstImageTurn = true;
+
+    showGrid();
+    // Time from the request of the images until they are on screen
+    Profiler::instance().record("latency", requestTime, Profiler::Clock::now());
+}
 
+void ImageTransformer::showGrid() {
+    ScopedTimer timer("imshow");
+    if (!Profiler::instance().overlayEnabled()) {
         imshow("Display", grid);
+        return;
     }
+    // Draw the overlay on a copy so that the grid stays clean
+    grid.copyTo(overlayBuffer);
+    Profiler::instance().drawOverlay(overlayBuffer);
+    imshow("Display", overlayBuffer);
+}
+
+bool ImageTransformer::stitch(const string& outputPath) {
+    PanoramaStitcher stitcher;
+    return stitcher.stitch(files, outputPath);
+}
+
+void ImageTransformer::registerSequence() {
+    cout << "Registering " << files.size() << " images..." << endl;
+    auto start = Profiler::Clock::now();
+    vector<Registration> registrations = matcher.registerSequence(files);
+    Profiler::instance().record("sequence registration", start, Profiler::Clock::now());
+    double seconds = chrono::duration<double>(Profiler::Clock::now() - start).count();
+
+    // Each line holds: image number, matches, inliers, the 9 homography entries
+    ofstream output(constants::registrationFile);
+    int failed = 0;
+    for (size_t i = 0; i < registrations.size(); i++) {
+        const Registration& registration = registrations[i];
+        output << i + 1 << ' ' << registration.matches << ' ' << registration.inliers;
+        if (registration.H.empty()) {
+            failed++;
+        } else {
+            for (int j = 0; j < 9; j++) {
+                output << ' ' << registration.H.at<double>(j / 3, j % 3);
+            }
+        }
+        output << '\n';
+    }
+    cout << "Registered " << registrations.size() << " pairs in " << seconds << " s, " << failed
+         << " failed. Homographies written to " << constants::registrationFile << endl;
+}
+
+void ImageTransformer::drawPlaceholder(Mat& grid, int position) {
+    Mat targetROI = grid(Rect((position % 2) * N2, (position / 2) * N1, N2, N1));
+    targetROI.setTo(Scalar(40, 40, 40));
+
+    int baseline = 0;
+    Size textSize = getTextSize(constants::loadingMessage, FONT_HERSHEY_SIMPLEX, 0.75, 2, &baseline);
+    Point textOrg((N2 - textSize.width) / 2, (N1 + textSize.height) / 2);
+    putText(targetROI, constants::loadingMessage, textOrg, FONT_HERSHEY_SIMPLEX, 0.75, Scalar(255, 255, 255), 2);
 }
 
 cv::Mat ImageTransformer::cropRectangle(const cv::Mat& img, const cv::Point& center, int width, int height) {
@@ -84,26 +173,12 @@ void ImageTransformer::fillGrid(Mat& grid, const Mat& img, int position) {
     img.copyTo(targetROI);
 }
 
-vector<string> ImageTransformer::getFiles(const string& path) {
-    vector<string> files;
-    try {
-        if (!filesystem::exists(path)) {
-            cerr << "ERROR: Path does not exist. Correct it in constants.h file" << endl;
-            return files;
-        }
-        for (const auto& entry : filesystem::directory_iterator(path)) {
-            files.push_back(entry.path().string());
-        }
-
-        // Sort files using a custom lambda that compares the extracted numbers
-        std::sort(files.begin(), files.end(), [this](const string& a, const string& b) {
-            return extractNumber(a) < extractNumber(b);
-        });
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << e.what() << endl;
-        return files;
+void ImageTransformer::refreshFiles() {
+    if (!directory || !directory->poll()) {
+        return;
     }
-    return files;
+    files = directory->files();
+    cout << "Data directory changed, " << files.size() << " images" << endl;
 }
 
 void ImageTransformer::mouseCallback(int event, int x, int y, int flags, void* userdata) {
@@ -131,7 +206,7 @@ void ImageTransformer::mouseCallback(int event, int x, int y, int flags, void* u
                 circle(processor->grid, circleDraw, constants::circleRadius, processor->PointColor, constants::circleRadius);
             }
         }
-        imshow("Display", processor->grid);
+        processor->showGrid();
     }
 }
 
@@ -172,15 +247,32 @@ cv::Mat ImageTransformer::createWelcomeScreen(const std::vector<std::string>& me
 void ImageTransformer::run() {
     namedWindow("Display", WINDOW_AUTOSIZE);
     setMouseCallback("Display", ImageTransformer::mouseCallback, this);
-    imshow("Display", grid);
+    showGrid();
 
     while (true) {
         int number = -1;
-        char key = waitKey(0);
+        char key = waitForKey();
         if (key == 'q') break;
         else if (key == 13 || key == 10) {
             displayImages(selectedImage);
         }
+        else if (key == 'm') {
+            autoMatch = !autoMatch;
+            cout << "Automatic matching " << (autoMatch ? "on" : "off") << endl;
+            if (selectedImage != -1) {
+                displayImages(selectedImage);
+            }
+        }
+        else if (key == 'r') {
+            registerSequence();
+        }
+        else if (key == 'h') {
+            Profiler::instance().toggleOverlay();
+            showGrid();
+        }
+        else if (key == 't') {
+            Profiler::instance().writeTrace(constants::traceFile);
+        }
         else if (key >= '0' && key <= '9') {
             // If the key is a digit, we process it to construct a number
             string numberStr = "";
@@ -188,7 +280,7 @@ void ImageTransformer::run() {
 
             // Continue to capture digits until Enter is pressed
             while(true) {
-                key = waitKey(0);
+                key = waitForKey();
                 if (key == 13 || key == 10) { // If Enter is pressed, break
                     number = atoi(numberStr.c_str());
                     selectedImage = number;
@@ -205,6 +297,18 @@ void ImageTransformer::run() {
     }
 }
 
+char ImageTransformer::waitForKey() {
+    while (true) {
+        int key = waitKey(constants::pollDelay);
+        if (key != -1) {
+            return key;
+        }
+        // Show the images that finished decoding while no key is pressed
+        refreshFiles();
+        showPendingImages();
+    }
+}
+
 cv::Mat ImageTransformer::findHomographyMap(const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2, const cv::Mat& img1, const cv::Mat& img2) {
     if (pts1.empty() || pts2.empty() || pts1.size() != pts2.size()) {
         std::cerr << "Error: Point sets are empty or not of equal size." << std::endl;
@@ -216,7 +320,7 @@ cv::Mat ImageTransformer::findHomographyMap(const std::vector<cv::Point2f>& pts1
 
     // Warp the second image using the homography matrix
     cv::Mat img2Transformed;
-    cv::warpPerspective(img2, img2Transformed, H, img2.size());
+    warpCache.warp(img2, img2Transformed, H, img2.size());
 
     // Convert points to keypoints for visualization
     std::vector<cv::KeyPoint> keypoints1, keypoints2Transformed;
@@ -224,19 +328,13 @@ cv::Mat ImageTransformer::findHomographyMap(const std::vector<cv::Point2f>& pts1
         keypoints1.emplace_back(pt, 1.f);
     }
 
+    // Transform all points and measure their distance to the points of the first image in one pass
     std::vector<cv::Point2f> pts2Transformed;
-    for (const auto& pt : points2) {
-        // Manually apply homography to points2 for keypoint generation (optional, as they may be off the visible area)
-        std::vector<cv::Point2f> ptWrapper(1, pt), ptTransformed;
-        cv::perspectiveTransform(ptWrapper, ptTransformed, H);
-        keypoints2Transformed.emplace_back(ptTransformed[0], 1.f);
-        pts2Transformed.push_back(ptTransformed[0]);
+    double error = calculateAverageError(H, pts2, pts1, pts2Transformed);
+    for (const auto& pt : pts2Transformed) {
+        keypoints2Transformed.emplace_back(pt, 1.f);
     }
 
-    // Calculate the average error between the original and transformed points
-    // find pts2transformed from keypoints2Transformed
-    double error = calculateAverageError(pts1, pts2Transformed);
-
     std::cout << "Average error in built-in method: " << error << std::endl;
 
     // Create dummy matches since every point is assumed to match its counterpart
@@ -251,23 +349,13 @@ cv::Mat ImageTransformer::findHomographyMap(const std::vector<cv::Point2f>& pts1
     return imgMatches;
 }
 
-double ImageTransformer::calculateAverageError(const std::vector<cv::Point2f>& originalPoints, const std::vector<cv::Point2f>& transformedPoints) {
+double ImageTransformer::calculateAverageError(const cv::Mat& H, const std::vector<cv::Point2f>& points, const std::vector<cv::Point2f>& targets, std::vector<cv::Point2f>& transformedPoints) {
     // Check if the vectors are of the same size
-    if (originalPoints.size() != transformedPoints.size() || originalPoints.empty()) {
+    if (H.empty() || points.size() != targets.size() || points.empty()) {
         std::cerr << "Error: Points vectors are empty or not of the same size." << std::endl;
         return -1.0; // Return an error code
     }
-
-    // Sum the Euclidean distances between original and transformed points
-    double totalError = 0.0;
-    for (size_t i = 0; i < originalPoints.size(); i++) {
-        cv::Point2f diff = originalPoints[i] - transformedPoints[i];
-        totalError += cv::sqrt(diff.x*diff.x + diff.y*diff.y);
-    }
-
-    // Calculate the average error
-    double averageError = totalError / originalPoints.size();
-    return averageError;
+    return HomographyEstimator::averageError(cv::Matx33d(H), points, targets, transformedPoints);
 }
 
 cv::Scalar ImageTransformer::generateRandomColor() {
@@ -290,46 +378,20 @@ cv::Mat ImageTransformer::computeHomography(const std::vector<cv::Point2f>& pts1
         return cv::Mat();
     }
 
-    const int N = pts1.size();
-    cv::Mat A(2*N, 9, CV_32F);
-    for (int i = 0; i < N; ++i) {
-        float x = pts1[i].x, y = pts1[i].y;
-        float xp = pts2[i].x, yp = pts2[i].y;
-
-        A.at<float>(2*i, 0) = -x;
-        A.at<float>(2*i, 1) = -y;
-        A.at<float>(2*i, 2) = -1;
-        A.at<float>(2*i, 3) = 0;
-        A.at<float>(2*i, 4) = 0;
-        A.at<float>(2*i, 5) = 0;
-        A.at<float>(2*i, 6) = x*xp;
-        A.at<float>(2*i, 7) = y*xp;
-        A.at<float>(2*i, 8) = xp;
-
-        A.at<float>(2*i+1, 0) = 0;
-        A.at<float>(2*i+1, 1) = 0;
-        A.at<float>(2*i+1, 2) = 0;
-        A.at<float>(2*i+1, 3) = -x;
-        A.at<float>(2*i+1, 4) = -y;
-        A.at<float>(2*i+1, 5) = -1;
-        A.at<float>(2*i+1, 6) = x*yp;
-        A.at<float>(2*i+1, 7) = y*yp;
-        A.at<float>(2*i+1, 8) = yp;
-    }
-
-    cv::Mat w, u, vt;
-    cv::SVD::compute(A, w, u, vt, cv::SVD::MODIFY_A | cv::SVD::FULL_UV);
-
-    cv::Mat h = vt.row(8); // The last row of V^T
-    cv::Mat H(3, 3, CV_32F);
-    for (int i = 0; i < 9; ++i) {
-        H.at<float>(i/3, i%3) = h.at<float>(0, i);
+    // Estimate the homography robustly, outliers among the points do not affect it
+    HomographyEstimator estimator(constants::ransacThreshold, constants::ransacConfidence, constants::ransacMaxIterations,
+                                  constants::refineIterations);
+    std::vector<uchar> inliers;
+    cv::Mat H = estimator.estimate(pts1, pts2, inliers);
+    if (H.empty()) {
+        std::cerr << "No homography consistent with the points was found." << std::endl;
+        return cv::Mat();
     }
-
+    std::cout << "Inliers in custom method: " << cv::countNonZero(inliers) << "/" << pts1.size() << std::endl;
 
     // Warp the second image using the homography matrix
     cv::Mat img2Transformed;
-    cv::warpPerspective(img2, img2Transformed, H, img2.size());
+    warpCache.warp(img2, img2Transformed, H, img2.size());
 
     // Convert points to keypoints for visualization
     std::vector<cv::KeyPoint> keypoints1, keypoints2Transformed;
@@ -337,18 +399,12 @@ cv::Mat ImageTransformer::computeHomography(const std::vector<cv::Point2f>& pts1
         keypoints1.emplace_back(pt, 1.f);
     }
 
+    // Transform all points and measure their distance to the points of the first image in one pass
     std::vector<cv::Point2f> pts2Transformed;
-    for (const auto& pt : points2) {
-        // Manually apply homography to points2 for keypoint generation (optional, as they may be off the visible area)
-        std::vector<cv::Point2f> ptWrapper(1, pt), ptTransformed;
-        cv::perspectiveTransform(ptWrapper, ptTransformed, H);
-        keypoints2Transformed.emplace_back(ptTransformed[0], 1.f);
-        pts2Transformed.push_back(ptTransformed[0]);
+    double error = calculateAverageError(H, pts2, pts1, pts2Transformed);
+    for (const auto& pt : pts2Transformed) {
+        keypoints2Transformed.emplace_back(pt, 1.f);
     }
-
-    // Calculate the average error between the original and transformed points
-    // find pts2transformed from keypoints2Transformed
-    double error = calculateAverageError(pts1, pts2Transformed);
     std::cout << "Average error in custom method: " << error << std::endl;
     std::cout << "Homography matrix:" << std::endl;
     std::cout << H << std::endl;
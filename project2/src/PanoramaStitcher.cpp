@@ -0,0 +1,281 @@
+#include <PanoramaStitcher.h>
+#include <AsyncImageLoader.h>
+#include <Profiler.h>
+#include <constants.h>
+#include <algorithm>
+#include <cfloat>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+bool PanoramaStitcher::stitch(const vector<string>& files, const string& outputPath) {
+    if (files.size() < 2) {
+        cerr << "At least two images are needed for a panorama." << endl;
+        return false;
+    }
+    auto start = Profiler::Clock::now();
+    cout << "Registering " << files.size() << " images..." << endl;
+    vector<Size> sizes;
+    vector<Registration> registrations;
+    {
+        ScopedTimer timer("sequence registration");
+        registrations = matcher.registerSequence(files, &sizes);
+    }
+
+    // The middle image is the reference, so the distortion is spread evenly over both ends of the sequence
+    int reference = files.size() / 2;
+    vector<Matx33d> transforms;
+    vector<uchar> placed;
+    chain(registrations, reference, transforms, placed);
+
+    // Find the area of every image in the reference frame
+    vector<Rect2d> areas(files.size());
+    double left = DBL_MAX, top = DBL_MAX, right = -DBL_MAX, bottom = -DBL_MAX;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!placed[i] || sizes[i].empty()) {
+            placed[i] = 0;
+            continue;
+        }
+        double w = sizes[i].width, h = sizes[i].height;
+        double x0 = DBL_MAX, y0 = DBL_MAX, x1 = -DBL_MAX, y1 = -DBL_MAX;
+        for (const Point2d& corner : {Point2d(0, 0), Point2d(w, 0), Point2d(w, h), Point2d(0, h)}) {
+            Vec3d p = transforms[i] * Vec3d(corner.x, corner.y, 1);
+            if (p[2] <= DBL_EPSILON) {
+                // A corner behind the reference camera, the image cannot be shown in the mosaic
+                placed[i] = 0;
+                break;
+            }
+            x0 = min(x0, p[0] / p[2]);
+            y0 = min(y0, p[1] / p[2]);
+            x1 = max(x1, p[0] / p[2]);
+            y1 = max(y1, p[1] / p[2]);
+        }
+        if (!placed[i]) {
+            continue;
+        }
+        areas[i] = Rect2d(x0, y0, x1 - x0, y1 - y0);
+        left = min(left, x0);
+        top = min(top, y0);
+        right = max(right, x1);
+        bottom = max(bottom, y1);
+    }
+    if (!placed[reference]) {
+        cerr << "The reference image " << files[reference] << " could not be loaded." << endl;
+        return false;
+    }
+    if (right - left > constants::panoramaMaxSize || bottom - top > constants::panoramaMaxSize) {
+        cerr << "The mosaic would be " << int(right - left) << "x" << int(bottom - top)
+             << " pixels, the registration has probably drifted." << endl;
+        return false;
+    }
+    Size mosaicSize(cvCeil(right - left), cvCeil(bottom - top));
+    Rect mosaic(Point(0, 0), mosaicSize);
+
+    // Split the mosaic into tiles and find the last image overlapping each tile
+    const int tileSize = constants::panoramaTileSize;
+    int cols = (mosaicSize.width + tileSize - 1) / tileSize;
+    int rows = (mosaicSize.height + tileSize - 1) / tileSize;
+    vector<Tile> tiles(rows * cols);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            tiles[r * cols + c].rect = Rect(c * tileSize, r * tileSize, tileSize, tileSize) & mosaic;
+        }
+    }
+    Matx33d offset(1, 0, -left,
+                   0, 1, -top,
+                   0, 0, 1);
+    vector<vector<int>> frameTiles(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!placed[i]) {
+            continue;
+        }
+        transforms[i] = offset * transforms[i];
+        Rect area = Rect(Point(cvFloor(areas[i].x - left), cvFloor(areas[i].y - top)),
+                         Point(cvCeil(areas[i].br().x - left) + 1, cvCeil(areas[i].br().y - top) + 1)) & mosaic;
+        for (int r = area.y / tileSize; r <= (area.br().y - 1) / tileSize; r++) {
+            for (int c = area.x / tileSize; c <= (area.br().x - 1) / tileSize; c++) {
+                frameTiles[i].push_back(r * cols + c);
+                tiles[r * cols + c].lastFrame = i;
+            }
+        }
+    }
+
+    error_code error;
+    filesystem::create_directories(outputPath, error);
+    if (error) {
+        cerr << "Cannot create " << outputPath << ": " << error.message() << endl;
+        return false;
+    }
+    double scale = min(1.0, double(constants::panoramaPreviewSize) / max(mosaicSize.width, mosaicSize.height));
+    Mat preview = Mat::zeros(max(1, cvRound(mosaicSize.height * scale)), max(1, cvRound(mosaicSize.width * scale)), CV_8UC3);
+
+    auto tilePath = [&](int id) {
+        string name = to_string(id / cols) + "_" + to_string(id % cols) + ".jpg";
+        return (filesystem::path(outputPath) / name).string();
+    };
+
+    // Decode a few images ahead while the current one is blended
+    AsyncImageLoader loader;
+    vector<shared_future<Mat>> pending(files.size());
+    size_t next = 0;
+    int blended = 0, written = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        for (; next < min(files.size(), i + constants::panoramaPrefetch + 1); next++) {
+            if (placed[next]) {
+                pending[next] = loader.load(files[next]);
+            }
+        }
+        if (!placed[i]) {
+            continue;
+        }
+        Mat frame = pending[i].get();
+        pending[i] = shared_future<Mat>();
+        const vector<int>& ids = frameTiles[i];
+
+        if (!frame.empty()) {
+            ScopedTimer timer("panorama blend");
+            const Mat& frameWeights = featherWeights(frame.size());
+            parallel_for_(Range(0, ids.size()), [&](const Range& range) {
+                for (int k = range.start; k < range.end; k++) {
+                    blend(tiles[ids[k]], frame, transforms[i], frameWeights);
+                }
+            });
+            blended++;
+        }
+
+        // Write and free the tiles that no later image overlaps
+        vector<int> finished;
+        for (int id : ids) {
+            if (tiles[id].lastFrame == (int)i) {
+                finished.push_back(id);
+            }
+        }
+        ScopedTimer timer("panorama write");
+        parallel_for_(Range(0, finished.size()), [&](const Range& range) {
+            for (int k = range.start; k < range.end; k++) {
+                Tile& tile = tiles[finished[k]];
+                Mat result = finish(tile, tilePath(finished[k]));
+                tile.sum.release();
+                tile.weight.release();
+
+                // Tiles cover disjoint parts of the preview
+                Rect previewArea = Rect(Point(cvRound(tile.rect.x * scale), cvRound(tile.rect.y * scale)),
+                                        Point(cvRound(tile.rect.br().x * scale), cvRound(tile.rect.br().y * scale))) &
+                                   Rect(Point(0, 0), preview.size());
+                if (!previewArea.empty()) {
+                    Mat target = preview(previewArea);
+                    resize(result, target, previewArea.size(), 0, 0, INTER_AREA);
+                }
+            }
+        });
+        written += finished.size();
+    }
+
+    // No image covers the remaining tiles, they are written black so that every tile of the layout exists
+    vector<int> uncovered;
+    for (int id = 0; id < (int)tiles.size(); id++) {
+        if (tiles[id].lastFrame == -1) {
+            uncovered.push_back(id);
+        }
+    }
+    parallel_for_(Range(0, uncovered.size()), [&](const Range& range) {
+        for (int k = range.start; k < range.end; k++) {
+            finish(tiles[uncovered[k]], tilePath(uncovered[k]));
+        }
+    });
+    written += uncovered.size();
+
+    // The layout lets viewers find the tiles: mosaic size, tile size, tile rows and columns, reference image
+    ofstream layout(filesystem::path(outputPath) / constants::panoramaLayoutFile);
+    layout << mosaicSize.width << ' ' << mosaicSize.height << ' ' << tileSize << ' ' << rows << ' ' << cols << '\n'
+           << files[reference] << '\n';
+    imwrite((filesystem::path(outputPath) / constants::panoramaPreviewFile).string(), preview);
+
+    double seconds = chrono::duration<double>(Profiler::Clock::now() - start).count();
+    cout << "Stitched " << blended << " of " << files.size() << " images into a " << mosaicSize.width << "x"
+         << mosaicSize.height << " mosaic of " << written << " tiles in " << seconds << " s. Written to " << outputPath << endl;
+    return true;
+}
+
+void PanoramaStitcher::chain(const vector<Registration>& registrations, int reference,
+                             vector<Matx33d>& transforms, vector<uchar>& placed) {
+    size_t count = registrations.size() + 1;
+    transforms.assign(count, Matx33d::eye());
+    placed.assign(count, 0);
+    placed[reference] = 1;
+    // Registration i maps image i to image i + 1, walk away from the reference in both directions
+    for (int i = reference - 1; i >= 0 && !registrations[i].H.empty(); i--) {
+        transforms[i] = transforms[i + 1] * Matx33d(registrations[i].H);
+        placed[i] = 1;
+    }
+    for (size_t i = reference + 1; i < count && !registrations[i - 1].H.empty(); i++) {
+        transforms[i] = transforms[i - 1] * Matx33d(registrations[i - 1].H).inv();
+        placed[i] = 1;
+    }
+}
+
+const Mat& PanoramaStitcher::featherWeights(Size size) {
+    if (weights.rows == size.height && weights.cols == size.width) {
+        return weights;
+    }
+    // The weight falls off linearly towards every border, so seams between images are blended smoothly
+    weights.create(size, CV_32F);
+    for (int y = 0; y < size.height; y++) {
+        float wy = min(y + 1, size.height - y) / (0.5f * size.height);
+        float* row = weights.ptr<float>(y);
+        for (int x = 0; x < size.width; x++) {
+            row[x] = wy * min(x + 1, size.width - x) / (0.5f * size.width);
+        }
+    }
+    return weights;
+}
+
+void PanoramaStitcher::blend(Tile& tile, const Mat& frame, const Matx33d& H, const Mat& frameWeights) {
+    if (tile.sum.empty()) {
+        tile.sum = Mat::zeros(tile.rect.size(), CV_32FC3);
+        tile.weight = Mat::zeros(tile.rect.size(), CV_32F);
+    }
+    Matx33d toTile = Matx33d(1, 0, -tile.rect.x,
+                             0, 1, -tile.rect.y,
+                             0, 0, 1) * H;
+    Mat warped, warpedWeights;
+    warpPerspective(frame, warped, toTile, tile.rect.size(), INTER_LINEAR, BORDER_CONSTANT);
+    warpPerspective(frameWeights, warpedWeights, toTile, tile.rect.size(), INTER_LINEAR, BORDER_CONSTANT);
+    for (int y = 0; y < tile.rect.height; y++) {
+        const uchar* pixels = warped.ptr<uchar>(y);
+        const float* w = warpedWeights.ptr<float>(y);
+        float* sum = tile.sum.ptr<float>(y);
+        float* total = tile.weight.ptr<float>(y);
+        for (int x = 0; x < tile.rect.width; x++) {
+            for (int c = 0; c < 3; c++) {
+                sum[3 * x + c] += w[x] * pixels[3 * x + c];
+            }
+            total[x] += w[x];
+        }
+    }
+}
+
+Mat PanoramaStitcher::finish(const Tile& tile, const string& path) {
+    Mat result(tile.rect.size(), CV_8UC3, Scalar::all(0));
+    if (!tile.sum.empty()) {
+        for (int y = 0; y < tile.rect.height; y++) {
+            const float* sum = tile.sum.ptr<float>(y);
+            const float* total = tile.weight.ptr<float>(y);
+            uchar* pixels = result.ptr<uchar>(y);
+            for (int x = 0; x < tile.rect.width; x++) {
+                if (total[x] > 0) {
+                    for (int c = 0; c < 3; c++) {
+                        pixels[3 * x + c] = saturate_cast<uchar>(sum[3 * x + c] / total[x]);
+                    }
+                }
+            }
+        }
+    }
+    if (!imwrite(path, result)) {
+        cerr << "Failed to write " << path << endl;
+    }
+    return result;
+}
@@ -0,0 +1,57 @@
+#include <Stabilizer.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+Stabilizer::Stabilizer(int history, int lookahead) : history(history), lookahead(lookahead) {}
+
+bool Stabilizer::push(const Mat& H, Matx33d& correction) {
+    // Keep the translation, rotation and scale of the motion, a failed estimate counts as no motion
+    if (!H.empty()) {
+        Matx33d M(H);
+        if (std::abs(M(2, 2)) > DBL_EPSILON) {
+            M *= 1.0 / M(2, 2);
+            position += Vec4d(M(0, 2), M(1, 2), atan2(M(1, 0), M(0, 0)), log(hypot(M(0, 0), M(1, 0))));
+        }
+    }
+    trajectory.push_back(position);
+    pending++;
+    if (pending <= lookahead) {
+        return false;
+    }
+    return flush(correction);
+}
+
+bool Stabilizer::flush(Matx33d& correction) {
+    if (pending == 0) {
+        return false;
+    }
+    int index = trajectory.size() - pending;
+    correction = correct(index);
+    pending--;
+    // Drop the frames that have left the window of the next frame
+    while ((int)trajectory.size() - pending > history) {
+        trajectory.pop_front();
+    }
+    return true;
+}
+
+Matx33d Stabilizer::correct(int index) const {
+    int first = max(0, index - history);
+    int last = min((int)trajectory.size() - 1, index + lookahead);
+    Vec4d smoothed;
+    for (int i = first; i <= last; i++) {
+        smoothed += trajectory[i];
+    }
+    smoothed *= 1.0 / (last - first + 1);
+
+    // Move the frame by the difference between the smoothed and the actual trajectory
+    Vec4d d = smoothed - trajectory[index];
+    double s = exp(d[3]), c = cos(d[2]) * s, n = sin(d[2]) * s;
+    return Matx33d(c, -n, d[0],
+                   n, c, d[1],
+                   0, 0, 1);
+}
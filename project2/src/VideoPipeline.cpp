@@ -0,0 +1,215 @@
+#include <VideoPipeline.h>
+#include <HomographyEstimator.h>
+#include <Stabilizer.h>
+#include <constants.h>
+#include <algorithm>
+#include <deque>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+VideoPipeline::VideoPipeline(bool stabilize)
+    : stabilize(stabilize), frames(constants::videoQueueSize), estimates(constants::videoQueueSize), outputs(constants::videoQueueSize) {}
+
+bool VideoPipeline::open(const string& source) {
+    // A number selects a camera by index, a device path is opened like a file but is live too
+    bool index = !source.empty() && all_of(source.begin(), source.end(), ::isdigit);
+    live = index || source.rfind("/dev/", 0) == 0;
+    bool opened = index ? capture.open(stoi(source)) : capture.open(source);
+    if (!opened) {
+        cerr << "Cannot open video source " << source << endl;
+        return false;
+    }
+    return true;
+}
+
+void VideoPipeline::run() {
+    if (!capture.isOpened()) {
+        return;
+    }
+    auto start = Profiler::Clock::now();
+    thread captureThread(&VideoPipeline::captureLoop, this);
+    thread estimateThread(&VideoPipeline::estimateLoop, this);
+    thread warpThread(stabilize ? &VideoPipeline::stabilizeLoop : &VideoPipeline::warpLoop, this);
+
+    // HighGUI has to run on the main thread
+    int shown = 0;
+    Output output;
+    while (outputs.pop(output)) {
+        {
+            ScopedTimer timer("imshow");
+            if (Profiler::instance().overlayEnabled()) {
+                output.view.copyTo(overlayBuffer);
+                Profiler::instance().drawOverlay(overlayBuffer);
+                imshow("Display", overlayBuffer);
+            } else {
+                imshow("Display", output.view);
+            }
+        }
+        // Time from the capture of the frame until it is on screen
+        Profiler::instance().record("latency", output.frame.captured, Profiler::Clock::now());
+        shown++;
+
+        int key = waitKey(1);
+        if (key == 'q') {
+            stop();
+        } else if (key == 'h') {
+            Profiler::instance().toggleOverlay();
+        } else if (key == 't') {
+            Profiler::instance().writeTrace(constants::traceFile);
+        }
+    }
+    stop();
+    captureThread.join();
+    estimateThread.join();
+    warpThread.join();
+
+    double seconds = chrono::duration<double>(Profiler::Clock::now() - start).count();
+    cout << "Showed " << shown << " frames in " << seconds << " s (" << shown / max(seconds, 1e-9) << " fps), "
+         << dropped << " dropped." << endl;
+}
+
+void VideoPipeline::captureLoop() {
+    for (int index = 0;; index++) {
+        Frame frame;
+        frame.index = index;
+        {
+            ScopedTimer timer("capture");
+            if (!capture.read(frame.image) || frame.image.empty()) {
+                break;
+            }
+        }
+        frame.captured = Profiler::Clock::now();
+        if (live) {
+            // Keep up with the camera, a frame that does not fit is dropped.
+            // A camera never runs out of frames, so the loop ends when the queue is closed
+            if (!frames.tryPush(std::move(frame))) {
+                if (frames.isClosed()) {
+                    break;
+                }
+                dropped++;
+            }
+        } else if (!frames.push(std::move(frame))) {
+            break;
+        }
+    }
+    frames.close();
+}
+
+void VideoPipeline::estimateLoop() {
+    HomographyEstimator estimator(constants::ransacThreshold, constants::ransacConfidence, constants::ransacMaxIterations,
+                                  constants::refineIterations);
+    Frame previous;
+    Mat previousSmall;
+    Frame frame;
+    while (frames.pop(frame)) {
+        Estimate estimate;
+        // Large frames are matched at a reduced width, which keeps the estimation within the frame time
+        double scale = min(1.0, double(constants::videoEstimationWidth) / frame.image.cols);
+        Mat small = frame.image;
+        if (scale < 1.0) {
+            ScopedTimer timer("resize");
+            resize(frame.image, small, Size(), scale, scale, INTER_AREA);
+        }
+        if (!previous.image.empty()) {
+            ScopedTimer timer("video homography");
+            // The frame numbers key the feature cache, so every frame is detected once
+            vector<Point2f> pts1, pts2;
+            matcher.match(to_string(previous.index), previousSmall, to_string(frame.index), small, pts1, pts2);
+            vector<uchar> inliers;
+            Mat H = estimator.estimate(pts1, pts2, inliers);
+            if (!H.empty()) {
+                // Bring the homography back to full resolution coordinates
+                Matx33d S(scale, 0, 0,
+                          0, scale, 0,
+                          0, 0, 1);
+                estimate.H = Mat(S.inv() * Matx33d(H) * S);
+                estimate.inliers = countNonZero(inliers);
+            }
+            estimate.previous = previous.image;
+        }
+        previous = frame;
+        previousSmall = small;
+        estimate.frame = std::move(frame);
+        if (!estimates.push(std::move(estimate))) {
+            break;
+        }
+    }
+    estimates.close();
+}
+
+void VideoPipeline::warpLoop() {
+    Estimate estimate;
+    while (estimates.pop(estimate)) {
+        const Mat& image = estimate.frame.image;
+        Output output;
+        {
+            ScopedTimer timer("video warp");
+            // The current frame on the left, the previous frame warped onto it on the right
+            output.view = Mat::zeros(image.rows, image.cols * 2, image.type());
+            image.copyTo(output.view(Rect(0, 0, image.cols, image.rows)));
+            Mat right = output.view(Rect(image.cols, 0, image.cols, image.rows));
+            if (!estimate.H.empty()) {
+                warpPerspective(estimate.previous, right, estimate.H, image.size());
+            }
+            string status = estimate.H.empty() ? "No homography" : "Inliers: " + to_string(estimate.inliers);
+            putText(output.view, status, Point(image.cols + 10, 30), FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 255, 0), 2);
+        }
+        output.frame = std::move(estimate.frame);
+        if (!outputs.push(std::move(output))) {
+            break;
+        }
+    }
+    outputs.close();
+}
+
+void VideoPipeline::stabilizeLoop() {
+    Stabilizer stabilizer(constants::stabilizationHistory, constants::stabilizationLookahead);
+    // Frames wait here until the upcoming frames of their window are estimated
+    deque<Frame> delayed;
+    Matx33d correction;
+    Estimate estimate;
+    bool running = true;
+    while (running && estimates.pop(estimate)) {
+        delayed.push_back(std::move(estimate.frame));
+        if (stabilizer.push(estimate.H, correction)) {
+            running = showStabilized(std::move(delayed.front()), correction);
+            delayed.pop_front();
+        }
+    }
+    // The video ended, stabilize the remaining frames with the frames that are left
+    while (running && stabilizer.flush(correction)) {
+        running = showStabilized(std::move(delayed.front()), correction);
+        delayed.pop_front();
+    }
+    outputs.close();
+}
+
+bool VideoPipeline::showStabilized(Frame frame, const Matx33d& correction) {
+    const Mat& image = frame.image;
+    Output output;
+    {
+        ScopedTimer timer("video stabilization");
+        // Zoom in around the center to hide the borders uncovered by the correction
+        double zoom = constants::stabilizationZoom;
+        Point2d center(image.cols / 2.0, image.rows / 2.0);
+        Matx33d Z(zoom, 0, (1 - zoom) * center.x,
+                  0, zoom, (1 - zoom) * center.y,
+                  0, 0, 1);
+
+        // The original frame on the left, the stabilized frame on the right
+        output.view = Mat::zeros(image.rows, image.cols * 2, image.type());
+        image.copyTo(output.view(Rect(0, 0, image.cols, image.rows)));
+        Mat right = output.view(Rect(image.cols, 0, image.cols, image.rows));
+        warpPerspective(image, right, Z * correction, image.size());
+    }
+    output.frame = std::move(frame);
+    return outputs.push(std::move(output));
+}
+
+void VideoPipeline::stop() {
+    frames.close();
+    estimates.close();
+    outputs.close();
+}
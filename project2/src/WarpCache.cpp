@@ -0,0 +1,52 @@
+#include <WarpCache.h>
+#include <Profiler.h>
+#include <constants.h>
+#include <cfloat>
+
+using namespace cv;
+using namespace std;
+
+void WarpCache::warp(const Mat& src, Mat& dst, const Mat& H, Size size, int interpolation) {
+    if (src.empty() || H.empty()) {
+        dst.release();
+        return;
+    }
+    const Maps& entry = maps(Matx33d(H), size, interpolation);
+    remap(src, dst, entry.map1, entry.map2, interpolation, BORDER_CONSTANT);
+}
+
+const WarpCache::Maps& WarpCache::maps(const Matx33d& H, Size size, int interpolation) {
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->H == H && it->size == size && it->interpolation == interpolation) {
+            // Move the tables to the front of the list
+            cache.splice(cache.begin(), cache, it);
+            return cache.front();
+        }
+    }
+
+    ScopedTimer timer("warp maps");
+    // Every destination pixel samples the source at its position mapped back by the inverse homography
+    Matx33d Hinv = H.inv();
+    Mat mapX(size, CV_32F), mapY(size, CV_32F);
+    parallel_for_(Range(0, size.height), [&](const Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            float* xs = mapX.ptr<float>(y);
+            float* ys = mapY.ptr<float>(y);
+            for (int x = 0; x < size.width; x++) {
+                double w = Hinv(2, 0) * x + Hinv(2, 1) * y + Hinv(2, 2);
+                // Pixels mapped from infinity fall outside the source and get the border color
+                w = std::abs(w) > DBL_EPSILON ? 1.0 / w : 0.0;
+                xs[x] = w != 0.0 ? (Hinv(0, 0) * x + Hinv(0, 1) * y + Hinv(0, 2)) * w : -1.f;
+                ys[x] = w != 0.0 ? (Hinv(1, 0) * x + Hinv(1, 1) * y + Hinv(1, 2)) * w : -1.f;
+            }
+        }
+    });
+
+    Maps entry{H, size, interpolation};
+    convertMaps(mapX, mapY, entry.map1, entry.map2, CV_16SC2, interpolation == INTER_NEAREST);
+    cache.push_front(std::move(entry));
+    if (cache.size() > constants::warpCacheSize) {
+        cache.pop_back();
+    }
+    return cache.front();
+}
@@ -0,0 +1,253 @@
+// benchmark.cpp
+// Compares the homography estimators on synthetic correspondences and on the matched keypoints of the data directory.
+// Usage: benchmark [output csv] [runs per configuration]
+#include <DirectoryIndex.h>
+#include <FeatureMatcher.h>
+#include <HomographyEstimator.h>
+#include <Profiler.h>
+#include <constants.h>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+/**
+ * @brief A homography estimator under test.
+ */
+struct Method {
+    string name; ///< Name written to the CSV.
+    function<Mat(const vector<Point2f>&, const vector<Point2f>&)> estimate; ///< Estimates the homography mapping the first points to the second.
+};
+
+/**
+ * @brief The timings and errors of one estimator on one configuration.
+ */
+struct Result {
+    vector<double> milliseconds; ///< Duration of every successful estimate.
+    double error = 0; ///< Sum of the mean reprojection errors of the successful estimates.
+    double inlierRatio = 0; ///< Sum of the inlier ratios of the successful estimates.
+    int failures = 0; ///< Number of estimates that returned no homography.
+};
+
+/**
+ * @brief The noise-free positions of the synthetic inliers in both images.
+ */
+struct Truth {
+    vector<Point2f> pts1; ///< Points in the first image.
+    vector<Point2f> pts2; ///< The points mapped by the true homography.
+};
+
+const Size frameSize(1920, 1080); ///< Image size the synthetic points are drawn in.
+const int pointCounts[] = {100, 1000, 5000, 10000}; ///< Numbers of synthetic correspondences.
+const double noiseLevels[] = {0.5, 2.0}; ///< Standard deviations of the synthetic point noise in pixels.
+const double outlierRatios[] = {0.0, 0.3, 0.6}; ///< Fractions of synthetic correspondences replaced by random points.
+
+vector<Method> methods() {
+    HomographyEstimator ransac(constants::ransacThreshold, constants::ransacConfidence, constants::ransacMaxIterations);
+    HomographyEstimator refined(constants::ransacThreshold, constants::ransacConfidence, constants::ransacMaxIterations,
+                                constants::refineIterations);
+    return {
+        {"findHomography RANSAC", [](const vector<Point2f>& pts1, const vector<Point2f>& pts2) {
+             return findHomography(pts1, pts2, RANSAC, constants::ransacThreshold);
+         }},
+        {"custom RANSAC", [ransac](const vector<Point2f>& pts1, const vector<Point2f>& pts2) {
+             vector<uchar> inliers;
+             return ransac.estimate(pts1, pts2, inliers);
+         }},
+        {"custom RANSAC + LM", [refined](const vector<Point2f>& pts1, const vector<Point2f>& pts2) {
+             vector<uchar> inliers;
+             return refined.estimate(pts1, pts2, inliers);
+         }},
+        {"DLT", [](const vector<Point2f>& pts1, const vector<Point2f>& pts2) {
+             return HomographyEstimator::fitLeastSquares(pts1, pts2);
+         }},
+    };
+}
+
+/**
+ * @brief Draws a plausible camera motion by moving the image corners.
+ */
+Matx33d randomHomography(RNG& rng) {
+    vector<Point2f> corners = {Point2f(0, 0), Point2f(frameSize.width, 0), Point2f(frameSize.width, frameSize.height),
+                               Point2f(0, frameSize.height)};
+    vector<Point2f> moved;
+    for (const Point2f& corner : corners) {
+        moved.emplace_back(corner.x + rng.uniform(-0.15, 0.15) * frameSize.width,
+                           corner.y + rng.uniform(-0.15, 0.15) * frameSize.height);
+    }
+    return Matx33d(getPerspectiveTransform(corners, moved));
+}
+
+/**
+ * @brief Generates noisy correspondences of a homography with a fraction of outliers.
+ */
+void generate(RNG& rng, const Matx33d& H, int n, double noise, double outliers,
+              vector<Point2f>& pts1, vector<Point2f>& pts2, Truth& truth) {
+    pts1.resize(n);
+    pts2.resize(n);
+    truth.pts1.clear();
+    truth.pts2.clear();
+    for (int i = 0; i < n; i++) {
+        pts1[i] = Point2f(rng.uniform(0.f, (float)frameSize.width), rng.uniform(0.f, (float)frameSize.height));
+        if (rng.uniform(0.0, 1.0) < outliers) {
+            pts2[i] = Point2f(rng.uniform(0.f, (float)frameSize.width), rng.uniform(0.f, (float)frameSize.height));
+            continue;
+        }
+        Vec3d p = H * Vec3d(pts1[i].x, pts1[i].y, 1);
+        truth.pts1.push_back(pts1[i]);
+        truth.pts2.emplace_back(p[0] / p[2], p[1] / p[2]);
+        pts1[i] += Point2f(rng.gaussian(noise), rng.gaussian(noise));
+        pts2[i] = truth.pts2.back() + Point2f(rng.gaussian(noise), rng.gaussian(noise));
+    }
+}
+
+/**
+ * @brief Times one estimate and adds its error to the result.
+ * @param truth The true inlier positions, or null to measure the error on the matches within the RANSAC threshold.
+ */
+void measure(const Method& method, const vector<Point2f>& pts1, const vector<Point2f>& pts2, const Truth* truth, Result& result) {
+    auto start = Profiler::Clock::now();
+    Mat H = method.estimate(pts1, pts2);
+    double milliseconds = chrono::duration<double, milli>(Profiler::Clock::now() - start).count();
+    if (H.empty()) {
+        result.failures++;
+        return;
+    }
+    result.milliseconds.push_back(milliseconds);
+
+    vector<float> squaredErrors(pts1.size());
+    HomographyEstimator::reprojectionErrors(Matx33d(H), pts1, pts2, squaredErrors.data());
+    float threshold2 = constants::ransacThreshold * constants::ransacThreshold;
+    int inliers = count_if(squaredErrors.begin(), squaredErrors.end(), [&](float e) { return e <= threshold2; });
+    result.inlierRatio += double(inliers) / pts1.size();
+
+    if (truth) {
+        // Distance between the estimated and the true positions of the noise-free inliers
+        vector<Point2f> transformed;
+        result.error += HomographyEstimator::averageError(Matx33d(H), truth->pts1, truth->pts2, transformed);
+    } else {
+        double sum = 0;
+        for (float e : squaredErrors) {
+            sum += e <= threshold2 ? std::sqrt(e) : 0.0;
+        }
+        result.error += inliers > 0 ? sum / inliers : 0.0;
+    }
+}
+
+double percentile(vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t k = min(values.size() - 1, (size_t)(p * values.size()));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+void write(ofstream& csv, const string& source, const string& method, int n, const string& noise, const string& outliers,
+           const Result& result) {
+    int successes = result.milliseconds.size();
+    double total = 0;
+    for (double ms : result.milliseconds) {
+        total += ms;
+    }
+    csv << source << ',' << method << ',' << n << ',' << noise << ',' << outliers << ','
+        << successes + result.failures << ',' << result.failures << ','
+        << percentile(result.milliseconds, 0.5) << ',' << percentile(result.milliseconds, 0.9) << ','
+        << percentile(result.milliseconds, 0.99) << ','
+        << (total > 0 ? 1000.0 * successes / total : 0.0) << ','
+        << (successes > 0 ? result.error / successes : 0.0) << ','
+        << (successes > 0 ? result.inlierRatio / successes : 0.0) << '\n';
+}
+
+/**
+ * @brief Sort key of the images of the data directory, the number in their file name.
+ */
+long long frameNumber(const string& path) {
+    string name = path.substr(path.find_last_of("/\\") + 1);
+    string digits;
+    for (char c : name.substr(0, name.find_last_of('.'))) {
+        if (isdigit(c)) {
+            digits += c;
+        }
+    }
+    return digits.empty() ? 0 : stoll(digits);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    string outputPath = argc > 1 ? argv[1] : constants::benchmarkFile;
+    int runs = argc > 2 ? stoi(argv[2]) : constants::benchmarkRuns;
+    ofstream csv(outputPath);
+    if (!csv) {
+        cerr << "Cannot write " << outputPath << endl;
+        return 1;
+    }
+    csv << "source,method,points,noise,outliers,runs,failures,p50_ms,p90_ms,p99_ms,throughput_per_s,mean_error_px,inlier_ratio\n";
+    vector<Method> estimators = methods();
+
+    // Synthetic correspondences, every estimator sees the same point sets
+    for (int n : pointCounts) {
+        for (double noise : noiseLevels) {
+            for (double outliers : outlierRatios) {
+                vector<Result> results(estimators.size());
+                RNG rng(n * 1000 + noise * 100 + outliers * 10);
+                vector<Point2f> pts1, pts2;
+                Truth truth;
+                for (int run = 0; run < runs; run++) {
+                    generate(rng, randomHomography(rng), n, noise, outliers, pts1, pts2, truth);
+                    for (size_t m = 0; m < estimators.size(); m++) {
+                        measure(estimators[m], pts1, pts2, &truth, results[m]);
+                    }
+                }
+                for (size_t m = 0; m < estimators.size(); m++) {
+                    write(csv, "synthetic", estimators[m].name, n, to_string(noise), to_string(outliers), results[m]);
+                }
+                cout << "Synthetic: " << n << " points, noise " << noise << ", outliers " << outliers << endl;
+            }
+        }
+    }
+
+    // Keypoints matched between the consecutive images of the data directory
+    DirectoryIndex directory(constants::dataPath, frameNumber);
+    const vector<string>& files = directory.files();
+    FeatureMatcher matcher;
+    vector<Result> results(estimators.size());
+    long long matches = 0;
+    int pairs = 0;
+    for (size_t i = 0; i + 1 < files.size(); i++) {
+        Mat img1 = imread(files[i]), img2 = imread(files[i + 1]);
+        if (img1.empty() || img2.empty()) {
+            continue;
+        }
+        vector<Point2f> pts1, pts2;
+        matcher.match(files[i], img1, files[i + 1], img2, pts1, pts2);
+        if (pts1.size() < 4) {
+            continue;
+        }
+        matches += pts1.size();
+        pairs++;
+        for (size_t m = 0; m < estimators.size(); m++) {
+            for (int run = 0; run < runs; run++) {
+                measure(estimators[m], pts1, pts2, nullptr, results[m]);
+            }
+        }
+    }
+    if (pairs > 0) {
+        for (size_t m = 0; m < estimators.size(); m++) {
+            write(csv, "images", estimators[m].name, matches / pairs, "", "", results[m]);
+        }
+        cout << "Images: " << pairs << " pairs, " << matches / pairs << " matches on average" << endl;
+    }
+
+    cout << "Results written to " << outputPath << endl;
+    return 0;
+}
@@ -1,11 +1,37 @@
 // main.cpp
 #include <iostream>
 #include <ImageTransformer.h>
+#include <VideoPipeline.h>
 #include <constants.h>
+#include <string>
+
+int main(int argc, char** argv) {
+    // Stream modes: project2 --video|--stabilize <video file, device or camera index>
+    if (argc > 1 && (std::string(argv[1]) == "--video" || std::string(argv[1]) == "--stabilize")) {
+        if (argc != 3) {
+            std::cerr << "Usage: " << argv[0] << " " << argv[1] << " <video file, device or camera index>" << std::endl;
+            return 1;
+        }
+        VideoPipeline pipeline(std::string(argv[1]) == "--stabilize");
+        if (!pipeline.open(argv[2])) {
+            return 1;
+        }
+        pipeline.run();
+        return 0;
+    }
 
-int main() {
     ImageTransformer viewer;
     viewer.loadImages(constants::dataPath); // Adjust the path as necessary
+
+    // Headless mode: project2 --stitch <output directory>
+    if (argc > 1 && std::string(argv[1]) == "--stitch") {
+        if (argc != 3) {
+            std::cerr << "Usage: " << argv[0] << " --stitch <output directory>" << std::endl;
+            return 1;
+        }
+        return viewer.stitch(argv[2]) ? 0 : 1;
+    }
+
     std::cout << "Welcome to the Homogrophic Transformer!, Follow the instructions in the Window !" << std::endl;
     viewer.run();
     return 0;
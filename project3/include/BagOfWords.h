@@ -8,6 +8,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <BoundedQueue.h>
 
 using namespace std;
 struct ImageWithLabel;
@@ -20,6 +21,16 @@ public:
      * @return The similarity matrix of the images.
      */
     cv::Mat run(const string& path);
+
+    /**
+     * @brief Runs the Bag of Words algorithm on images produced by another thread.
+     * @param queue The queue the images are pushed to, closed after the last image.
+     * @return The similarity matrix of the images.
+     *
+     * The descriptors are extracted on all cores while the images arrive, and every image is released
+     * once it is described. Classes with fewer than constants::minClassImages images are left out.
+     */
+    cv::Mat run(BoundedQueue<ImageWithLabel>& queue);
     
     /**
      * @brief Visualizes the similarity matrix.
@@ -41,6 +52,21 @@ private:
      * @return The descriptors of the images.
      */
     std::vector<cv::Mat> getDescriptors(vector<ImageWithLabel> images);
+
+    /**
+     * @brief Extracts the descriptors of one image.
+     * @param image The image to extract descriptors from.
+     * @param detector The SIFT detector, used by one thread at a time.
+     * @return The descriptors of the image.
+     */
+    static cv::Mat describe(const cv::Mat& image, const cv::Ptr<cv::SIFT>& detector);
+
+    /**
+     * @brief Builds the vocabulary and the class histograms and compares the classes.
+     * @param descriptors The descriptors of the loaded images.
+     * @return The similarity matrix.
+     */
+    cv::Mat evaluate(const vector<cv::Mat>& descriptors);
     
     /**
      * @brief Builds a vocabulary from the descriptors.
@@ -87,6 +113,7 @@ private:
 struct ImageWithLabel {
     cv::Mat image; // Image data
     std::string label; // Image label
+    int index = 0; // Position of the image in the data set, keeps the results independent of the thread timing
 };
 
 #endif // BAGOFWORDS_H
\ No newline at end of file
@@ -0,0 +1,86 @@
+/**
+ * @file BlobExtractor.h
+ * @brief This file defines the BlobExtractor class, which extracts the largest connected component of a binary image.
+ *
+ * The image is scanned once as horizontal runs of foreground pixels. Touching runs are merged with a
+ * union-find that sums their areas, so no label image is needed. The mask of the largest component is
+ * painted from its runs, its holes are found the same way inside its bounding box, and the boundaries
+ * of the component and its holes are traced on the mask, giving the contours and their hierarchy
+ * without another pass over the frame.
+ */
+
+#ifndef BLOBEXTRACTOR_H
+#define BLOBEXTRACTOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @class BlobExtractor
+ * @brief Extracts the largest 8-connected component of a binary image with its contours.
+ *
+ * The run buffers are kept between calls, so an extractor should be reused by one thread.
+ */
+class BlobExtractor {
+public:
+    /**
+     * @brief Extracts the largest component of a binary image.
+     * @param binary The CV_8UC1 image, nonzero pixels are foreground.
+     * @param mask The CV_8UC1 mask of the largest component, all zero if there is none.
+     * @param contours The outer boundary of the component followed by the boundaries of its holes,
+     * compressed like cv::CHAIN_APPROX_SIMPLE. Empty if there is no component.
+     * @param hierarchy The hierarchy in the cv::findContours format, the holes are the children of the outer boundary.
+     * @return The area of the component in pixels, 0 if there is none.
+     */
+    int extract(const cv::Mat& binary, cv::Mat& mask, std::vector<std::vector<cv::Point>>& contours,
+                std::vector<cv::Vec4i>& hierarchy);
+
+private:
+    /**
+     * @brief A horizontal run of pixels.
+     */
+    struct Run {
+        int y; ///< Row of the run.
+        int start; ///< First column of the run.
+        int end; ///< Column after the last pixel of the run.
+    };
+
+    std::vector<Run> runs; ///< Runs in scan order.
+    std::vector<int> parent; ///< Union-find parent of every run, a root is the first run of its component.
+    std::vector<int> area; ///< Number of pixels of the component, valid for the roots.
+    std::vector<uchar> border; ///< Whether the component touches the border of the scanned area, valid for the roots.
+
+    /**
+     * @brief Collects the runs of a region of an image and merges the touching ones.
+     * @param image The CV_8UC1 image.
+     * @param roi The scanned area.
+     * @param foreground Whether to collect the nonzero or the zero pixels.
+     * @param eightConnected Whether diagonal neighbours touch.
+     */
+    void label(const cv::Mat& image, const cv::Rect& roi, bool foreground, bool eightConnected);
+
+    /**
+     * @brief Finds the root of a run and compresses the path to it.
+     * @param run The index of the run.
+     * @return The index of the root.
+     */
+    int find(int run);
+
+    /**
+     * @brief Merges the components of two runs.
+     * @param a The index of the first run.
+     * @param b The index of the second run.
+     */
+    void unite(int a, int b);
+
+    /**
+     * @brief Follows the boundary between the foreground and a background region of a mask.
+     * @param mask The CV_8UC1 mask.
+     * @param start A foreground pixel on the boundary.
+     * @param backtrack A background pixel of the region, 4-adjacent to the start.
+     * @return The boundary pixels, compressed like cv::CHAIN_APPROX_SIMPLE.
+     */
+    static std::vector<cv::Point> trace(const cv::Mat& mask, cv::Point start, cv::Point backtrack);
+};
+
+#endif // BLOBEXTRACTOR_H
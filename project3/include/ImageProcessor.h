@@ -12,7 +12,13 @@
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <constants.h>
+#include <AsyncImageLoader.h>
+#include <BlobExtractor.h>
+#include <DirectoryIndex.h>
+#include <Profiler.h>
 
 /**
  * @class ImageProcessor
@@ -23,6 +29,14 @@
  */
 class ImageProcessor {
 public:
+    /**
+     * @brief Receives a processed image, called on the worker threads of processAllImages.
+     * @param index The position of the image in the data directory, sorted by class and file name.
+     * @param className The name of the class directory of the image.
+     * @param component The rotated component extracted from the image.
+     */
+    using ComponentCallback = std::function<void(int index, const std::string& className, const cv::Mat& component)>;
+
     /**
      * @brief Constructor for the ImageProcessor class.
      */
@@ -42,21 +56,58 @@ public:
     /**
      * @brief Processes all images in a directory.
      * @param DataPath The path to the directory containing images.
-     * @param OutputPath The path to the directory where the processed images will be saved.
+     * @param OutputPath The path to the directory where the processed images will be saved, empty to not save them.
+     * @param onComponent Called with every processed image, may block to hold back the processing.
+     *
+     * The images of all classes are processed in parallel on a work-stealing pool. The output directory
+     * of a class is removed once its last image is done if fewer than constants::minClassImages of its
+     * images were processed.
+     */
+    void processAllImages(const std::string& DataPath, const std::string& OutputPath,
+                          const ComponentCallback& onComponent = nullptr);
+
+    /**
+     * @brief Computes inRange(cvtColor(bgr, COLOR_BGR2HSV), low, high) in one pass, without the HSV image.
+     * @param bgr The image.
+     * @param low The lower HSV bounds, inclusive.
+     * @param high The upper HSV bounds, inclusive.
+     * @param mask The CV_8UC1 mask, 255 for the pixels inside the range.
      */
-    void processAllImages(const std::string& DataPath, const std::string& OutputPath);
+    static void hsvRangeMask(const cv::Mat& bgr, const cv::Scalar& low, const cv::Scalar& high, cv::Mat& mask);
 
 private:
+    /**
+     * @brief Buffers reused by the images processed on the same thread.
+     */
+    struct Scratch {
+        cv::Mat greenMask; ///< Pixels in the green range, cleaned by the morphological operations.
+        cv::Mat morphology; ///< Intermediate result of the morphological operations.
+        BlobExtractor blobs; ///< Extractor of the largest connected component.
+        cv::Mat component; ///< Mask of the largest connected component.
+        std::vector<std::vector<cv::Point>> contours; ///< Boundaries of the largest component and its holes.
+        std::vector<cv::Vec4i> hierarchy; ///< Hierarchy of the boundaries, the holes are children of the outer one.
+        cv::Mat segmented; ///< The image inside the largest green component.
+        cv::Mat mask; ///< Filled mask of the inner contour, the size of its bounding rectangle.
+        cv::Mat maskedImage; ///< The image with everything outside the inner contour cleared, only within its bounding rectangle.
+    };
+
     static constexpr int width = constants::width; ///< Width of the display window.
     static constexpr int height = constants::height; ///< Height of the display window.
     int selectedImage = -1; ///< Index of the currently selected image.
     std::vector<std::string> files; ///< List of image file paths.
+    std::unique_ptr<DirectoryIndex> directory; ///< Live index of the data directory.
 
     cv::Mat img; ///< First image.
     cv::Mat displayImage; ///< Resized image for display.
     cv::Mat grid; ///< Grid to display the images.
+    cv::Mat overlayBuffer; ///< Copy of the grid with the timing overlay drawn on it.
+    Profiler::Clock::time_point requestTime; ///< Time the shown images were requested, for the display latency.
     int N1, N2; ///< Dimensions of the image grid.
     std::string path; ///< Path to the directory containing images.
+    AsyncImageLoader loader; ///< Worker pool decoding the images.
+    std::shared_future<cv::Mat> pendingImage; ///< Image being decoded for display.
+    int pendingNumber = -1; ///< Number of the image being decoded, -1 if none.
+    Scratch scratch; ///< Buffers of the displayed image.
 
     /**
      * @brief Displays images in a grid format.
@@ -64,28 +115,73 @@ private:
      */
     void displayImages(int num);
 
+    /**
+     * @brief Processes and shows the pending image once it is decoded.
+     */
+    void showPendingImages();
+
+    /**
+     * @brief Shows the grid in the window, with the timing overlay if it is enabled.
+     */
+    void showGrid();
+
+    /**
+     * @brief Draws a placeholder into a grid cell while its image is being decoded.
+     * @param grid The grid where the placeholder will be drawn.
+     * @param position The position in the grid where the placeholder will be drawn.
+     */
+    void drawPlaceholder(cv::Mat &grid, int position);
+
+    /**
+     * @brief Waits for a key press while showing the images that finish decoding.
+     * @return The pressed key.
+     */
+    char waitForKey();
+
     /**
      * @brief Extracts the Green Region from an image.
      * @param img The input image.
-     * @return A rgb mask of the green region.
+     * @param scratch The buffers of the calling thread, the result is stored in scratch.segmented
+     * and the boundaries of the region in scratch.contours.
+     * @return A rgb mask of the green region, valid until the next call with the same buffers.
      */
-    cv::Mat segmentGreenRegion(const cv::Mat& img);
+    cv::Mat segmentGreenRegion(const cv::Mat& img, Scratch& scratch);
 
     /**
-     * @brief Finds the boundaries of the green region in a rgb mask.
-     * @param mask The binary mask of the green region.
-     * @return A pair containing the rotated image and the contour of the green region.
+     * @brief Draws the boundaries of the green region and picks its largest inner contour.
+     * @param contours The boundaries of the green region and its holes.
+     * @param hierarchy The hierarchy of the boundaries in the cv::findContours format.
+     * @param size The size of the image.
+     * @return A pair containing the boundary image and the largest inner contour of the green region.
      */
-    std::pair<cv::Mat, std::vector<cv::Point>> findBoundaries(const cv::Mat& mask);
+    std::pair<cv::Mat, std::vector<cv::Point>> findBoundaries(const std::vector<std::vector<cv::Point>>& contours,
+                                                              const std::vector<cv::Vec4i>& hierarchy, cv::Size size);
 
     /**
      * @brief Rotates an image to make the inner region horizontal.
-     * @param img The input image.
+     * @param img The input image, only the pixels inside the bounding rectangle of the contour are read.
      * @param contour The contour of the green region.
-     * @return The rotated image.
+     * @return The upright crop of the minimum area rectangle of the contour, with its longer side horizontal.
      */
     cv::Mat rotateToHorizontal(const cv::Mat& img, const std::vector<cv::Point>& contour);
 
+    /**
+     * @brief Masks the inner region of an image and rotates it to be horizontal.
+     * @param img The input image.
+     * @param contour The inner contour of the green region.
+     * @param scratch The buffers of the calling thread.
+     * @return The upright crop of the inner region.
+     */
+    cv::Mat cropComponent(const cv::Mat& img, const std::vector<cv::Point>& contour, Scratch& scratch);
+
+    /**
+     * @brief Segments an image and extracts the rotated component inside the green region.
+     * @param img The input image.
+     * @param scratch The buffers of the calling thread.
+     * @return The rotated component, or an empty image if no inner contour was found.
+     */
+    cv::Mat extractComponent(const cv::Mat& img, Scratch& scratch);
+
     /**
      * @brief Creates a welcome screen with messages.
      * @param messages The messages to display on the welcome screen.
@@ -111,11 +207,9 @@ private:
     void fillGrid(cv::Mat &grid, const cv::Mat &img, int position);
 
     /**
-     * @brief Retrieves the list of files from a specified directory.
-     * @param path The path to the directory.
-     * @return A vector of strings containing the file paths.
+     * @brief Applies the files added to or removed from the data directory to the file list.
      */
-    std::vector<std::string> getFiles(const std::string &path);
+    void refreshFiles();
 };
 
 #endif // IMAGEPROCESSOR_H
@@ -0,0 +1,82 @@
+/**
+ * @file WorkStealingPool.h
+ * @brief This file defines the WorkStealingPool class, which runs a batch of jobs on all cores.
+ *
+ * Every worker owns a queue that starts with a contiguous block of the jobs, so neighbouring jobs
+ * run on the same thread. A worker takes its jobs from the front of its own queue and, once it is
+ * empty, steals from the back of the other queues, which keeps all cores busy when some jobs take
+ * much longer than others. Jobs receive the number of the worker running them to index per-thread
+ * scratch buffers.
+ */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Runs batches of independent jobs on a fixed number of worker threads.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @brief A job, called with the number of the worker running it, from 0 to size() - 1.
+     */
+    using Job = std::function<void(unsigned int worker)>;
+
+    /**
+     * @brief Constructor for the WorkStealingPool class.
+     * @param numThreads The number of worker threads. Uses all cores if zero.
+     */
+    explicit WorkStealingPool(unsigned int numThreads = 0);
+
+    /**
+     * @brief Returns the number of worker threads.
+     * @return The number of workers, which is also the number of scratch buffers the jobs need.
+     */
+    unsigned int size() const { return numThreads; }
+
+    /**
+     * @brief Runs the jobs and waits until all of them finished.
+     * @param jobs The jobs to run, in the order neighbouring jobs should preferably run in.
+     *
+     * If a job throws, the remaining jobs still run and the first exception is rethrown afterwards.
+     */
+    void run(std::vector<Job> jobs);
+
+private:
+    /**
+     * @brief The jobs owned by a worker.
+     */
+    struct Queue {
+        std::deque<Job> jobs; ///< Jobs not taken yet.
+        std::mutex mutex; ///< Guards the jobs, the owner and the thieves take jobs concurrently.
+    };
+
+    unsigned int numThreads; ///< Number of worker threads.
+    std::vector<std::unique_ptr<Queue>> queues; ///< One queue per worker.
+
+    /**
+     * @brief Takes the next job of a worker, from its own queue or stolen from another one.
+     * @param worker The number of the worker.
+     * @param job The taken job.
+     * @return False if every queue is empty.
+     */
+    bool take(unsigned int worker, Job& job);
+
+    /**
+     * @brief Main loop of the worker threads.
+     * @param worker The number of the worker.
+     * @param error The first exception thrown by a job.
+     * @param errorMutex Guards the exception.
+     */
+    void workerLoop(unsigned int worker, std::exception_ptr& error, std::mutex& errorMutex);
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <opencv2/opencv.hpp>
+#include <CommonConstants.h>
 
 namespace constants {
     // Image Processor Related Constants
@@ -15,7 +16,7 @@ namespace constants {
     const std::string outputPath = "../LearningData";
     constexpr int width = 192;
     constexpr int height = 108;
-    const std::vector<std::string> welcomeMessage = {"Welcome to the Image Processor!","Write the image number and press Enter to display the image.", "You can also move between the images by pressing 'a' and 'd' ","Press 'q' to quit.", "Prepared by: Ahmet Furkan Akinci"};
+    const std::vector<std::string> welcomeMessage = {"Welcome to the Image Processor!","Write the image number and press Enter to display the image.", "You can also move between the images by pressing 'a' and 'd' ","Press 'q' to quit.", "Press 'h' for stage timings, 't' to save them as a trace", "Prepared by: Ahmet Furkan Akinci"};
     const std::string windowName = "Image Processor";
     const std::string terminalMessage = "Welcome to the Image Processor!, Follow the instructions in the Window !";
     constexpr int circleRadius = 6;
@@ -24,9 +25,14 @@ namespace constants {
     const cv::Scalar SegHighLimit(70, 255, 255);
     const cv::Scalar OuterContourColor(255, 0, 0);
     const cv::Scalar InnerContourColor(0, 255, 0);
+    constexpr int pollDelay = 15; // Milliseconds to wait for a key press before checking pending decodes
+    const std::string loadingMessage = "Loading...";
+    const std::string traceFile = "trace.json"; // Chrome trace written when 't' is pressed
 
     // BOW Related Constants
     constexpr int vocabularySize = 100;
+    constexpr int minClassImages = 2; // Classes with fewer processed images are left out of the BOW
+    constexpr size_t componentQueueSize = 16; // Processed images buffered between the segmentation and the feature extraction
 }
 
 #endif // CONSTANTS_H
\ No newline at end of file
@@ -1,8 +1,12 @@
 #include <BagOfWords.h>
+#include <Profiler.h>
 #include <constants.h>
 
 #include <vector>
 #include <filesystem>
+#include <algorithm>
+#include <mutex>
+#include <thread>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -21,6 +25,59 @@ cv::Mat BagOfWords::run(const string& path)
         return cv::Mat();
     }
     vector<cv::Mat> descriptors = getDescriptors(images);
+    return evaluate(descriptors);
+}
+
+cv::Mat BagOfWords::run(BoundedQueue<ImageWithLabel>& queue)
+{
+    // describe the images on every core while the next ones are still being segmented
+    vector<pair<ImageWithLabel, cv::Mat>> described;
+    mutex describedMutex;
+    vector<thread> workers;
+    unsigned int numThreads = max(1u, thread::hardware_concurrency());
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.emplace_back([&] {
+            cv::Ptr<cv::SIFT> detector = cv::SIFT::create();
+            ImageWithLabel image;
+            while (queue.pop(image)) {
+                cv::Mat descriptor;
+                {
+                    ScopedTimer timer("sift");
+                    descriptor = describe(image.image, detector);
+                }
+                image.image.release(); // only the label is needed from now on
+                lock_guard<mutex> lock(describedMutex);
+                described.emplace_back(std::move(image), descriptor);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // restore the data set order and leave out the classes with too few images
+    sort(described.begin(), described.end(), [](const auto& a, const auto& b) { return a.first.index < b.first.index; });
+    map<string, int> classSizes;
+    for (const auto& entry : described) {
+        classSizes[entry.first.label]++;
+    }
+    images.clear();
+    vector<cv::Mat> descriptors;
+    for (auto& entry : described) {
+        if (classSizes[entry.first.label] >= constants::minClassImages) {
+            images.push_back(std::move(entry.first));
+            descriptors.push_back(entry.second);
+        }
+    }
+    if (images.empty()) {
+        cerr << "ERROR: No images processed. Check the path in constants.h file" << endl;
+        return cv::Mat();
+    }
+    return evaluate(descriptors);
+}
+
+cv::Mat BagOfWords::evaluate(const vector<cv::Mat>& descriptors)
+{
     cv::Mat Vocabulary = buildVocabulary(descriptors);
     vector<cv::Mat> histograms = buildHistograms(descriptors, Vocabulary);
     calculateAverageDescriptors(histograms);
@@ -92,21 +149,26 @@ std::vector<cv::Mat> BagOfWords::getDescriptors(vector<ImageWithLabel> images)
     vector<cv::Mat> descriptors;
     // iterate over the images and get the descriptors
     for (const auto& image : images) {
-        // convert the image to grayscale
-        cv::Mat gray;
-        cv::cvtColor(image.image, gray, cv::COLOR_BGR2GRAY);
-        // detect the keypoints
-        vector<cv::KeyPoint> keypoints;
-        detector->detect(gray, keypoints);
-        // compute the descriptors
-        cv::Mat descriptor;
-        detector->compute(gray, keypoints, descriptor);
         // add the descriptors to the vector
-        descriptors.push_back(descriptor);
+        descriptors.push_back(describe(image.image, detector));
     }
     return descriptors;
 }
 
+cv::Mat BagOfWords::describe(const cv::Mat& image, const cv::Ptr<cv::SIFT>& detector)
+{
+    // convert the image to grayscale
+    cv::Mat gray;
+    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    // detect the keypoints
+    vector<cv::KeyPoint> keypoints;
+    detector->detect(gray, keypoints);
+    // compute the descriptors
+    cv::Mat descriptor;
+    detector->compute(gray, keypoints, descriptor);
+    return descriptor;
+}
+
 cv::Mat BagOfWords::buildVocabulary(const vector<cv::Mat>& descriptors) {
     // concatenate all descriptors into a single cv::Mat object
     cv::Mat allDescriptors;
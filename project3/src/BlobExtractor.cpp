@@ -0,0 +1,213 @@
+#include <BlobExtractor.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Offsets of the 8 neighbours of a pixel, counterclockwise on screen starting to the right.
+ */
+const Point neighbours[8] = {Point(1, 0), Point(1, -1), Point(0, -1), Point(-1, -1),
+                             Point(-1, 0), Point(-1, 1), Point(0, 1), Point(1, 1)};
+
+/**
+ * @brief Returns the index of the neighbour offset leading from a pixel to an adjacent one.
+ */
+int direction(const Point& from, const Point& to) {
+    for (int k = 0; k < 8; k++) {
+        if (from + neighbours[k] == to) {
+            return k;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Keeps only the end points of the horizontal, vertical and diagonal segments of a closed boundary.
+ */
+vector<Point> compress(const vector<Point>& points) {
+    size_t n = points.size();
+    if (n < 3) {
+        return points;
+    }
+    vector<Point> corners;
+    for (size_t i = 0; i < n; i++) {
+        Point in = points[i] - points[(i + n - 1) % n];
+        Point out = points[(i + 1) % n] - points[i];
+        if (in != out) {
+            corners.push_back(points[i]);
+        }
+    }
+    return corners.empty() ? vector<Point>{points[0]} : corners;
+}
+
+} // namespace
+
+int BlobExtractor::extract(const Mat& binary, Mat& mask, vector<vector<Point>>& contours, vector<Vec4i>& hierarchy) {
+    contours.clear();
+    hierarchy.clear();
+    mask.create(binary.size(), CV_8UC1);
+    mask.setTo(Scalar::all(0));
+    label(binary, Rect(0, 0, binary.cols, binary.rows), true, true);
+
+    // Find the largest component, its root is its first run in scan order
+    int largest = -1;
+    for (int i = 0; i < (int)runs.size(); i++) {
+        if (parent[i] == i && (largest < 0 || area[i] > area[largest])) {
+            largest = i;
+        }
+    }
+    if (largest < 0) {
+        return 0;
+    }
+    int largestArea = area[largest];
+    Point first(runs[largest].start, runs[largest].y);
+
+    // Paint the runs of the component into the mask
+    int left = binary.cols, right = 0, bottom = 0;
+    for (int i = largest; i < (int)runs.size(); i++) {
+        if (find(i) != largest) {
+            continue;
+        }
+        const Run& run = runs[i];
+        memset(mask.ptr<uchar>(run.y) + run.start, 255, run.end - run.start);
+        left = min(left, run.start);
+        right = max(right, run.end);
+        bottom = run.y + 1;
+    }
+    Rect bounds(Point(left, first.y), Point(right, bottom));
+
+    // The pixel left of the first pixel is outside the component
+    contours.push_back(trace(mask, first, first - Point(1, 0)));
+    hierarchy.push_back(Vec4i(-1, -1, -1, -1));
+
+    // The holes are the background regions inside the bounding box that do not reach its border
+    label(mask, bounds, false, false);
+    for (int i = 0; i < (int)runs.size(); i++) {
+        if (parent[i] != i || border[i]) {
+            continue;
+        }
+        // The pixel above the first pixel of a hole is on the boundary around it
+        Point start(runs[i].start, runs[i].y);
+        contours.push_back(trace(mask, start - Point(0, 1), start));
+        int index = contours.size() - 1;
+        hierarchy.push_back(Vec4i(-1, index > 1 ? index - 1 : -1, -1, 0));
+        if (index > 1) {
+            hierarchy[index - 1][0] = index;
+        } else {
+            hierarchy[0][2] = index;
+        }
+    }
+    return largestArea;
+}
+
+void BlobExtractor::label(const Mat& image, const Rect& roi, bool foreground, bool eightConnected) {
+    runs.clear();
+    parent.clear();
+    area.clear();
+    border.clear();
+    const int slack = eightConnected ? 1 : 0;
+    const int right = roi.x + roi.width, bottom = roi.y + roi.height;
+    size_t previousBegin = 0, previousEnd = 0;
+    for (int y = roi.y; y < bottom; y++) {
+        const uchar* row = image.ptr<uchar>(y);
+        size_t currentBegin = runs.size();
+        size_t j = previousBegin;
+        int x = roi.x;
+        while (x < right) {
+            if ((row[x] != 0) != foreground) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x < right && (row[x] != 0) == foreground) {
+                x++;
+            }
+            int index = runs.size();
+            runs.push_back({y, start, x});
+            parent.push_back(index);
+            area.push_back(x - start);
+            border.push_back(y == roi.y || y == bottom - 1 || start == roi.x || x == right);
+
+            // Merge with the runs of the previous row touching this one
+            while (j < previousEnd && runs[j].end + slack <= start) {
+                j++;
+            }
+            for (size_t k = j; k < previousEnd && runs[k].start < x + slack; k++) {
+                unite(k, index);
+            }
+        }
+        previousBegin = currentBegin;
+        previousEnd = runs.size();
+    }
+}
+
+int BlobExtractor::find(int run) {
+    while (parent[run] != run) {
+        parent[run] = parent[parent[run]];
+        run = parent[run];
+    }
+    return run;
+}
+
+void BlobExtractor::unite(int a, int b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) {
+        return;
+    }
+    // The earlier run stays the root, so a root is always the first run of its component
+    if (b < a) {
+        swap(a, b);
+    }
+    parent[b] = a;
+    area[a] += area[b];
+    border[a] |= border[b];
+}
+
+vector<Point> BlobExtractor::trace(const Mat& mask, Point start, Point backtrack) {
+    auto foreground = [&mask](const Point& p) {
+        return p.x >= 0 && p.y >= 0 && p.x < mask.cols && p.y < mask.rows && mask.ptr<uchar>(p.y)[p.x] != 0;
+    };
+    // Border following of Suzuki and Abe: looking clockwise from the background pixel gives the boundary pixel
+    // before the start, the walk goes counterclockwise
+    int from = direction(start, backtrack);
+    Point last;
+    bool isolated = true;
+    for (int k = 0; k < 8 && isolated; k++) {
+        Point p = start + neighbours[(from - k + 8) % 8];
+        if (foreground(p)) {
+            last = p;
+            isolated = false;
+        }
+    }
+    if (isolated) {
+        return {start};
+    }
+
+    // Walk counterclockwise around every boundary pixel, starting next to the previous one,
+    // until the walk reaches the start again coming from the last pixel
+    vector<Point> points;
+    Point previous = last, current = start;
+    while (true) {
+        int back = direction(current, previous);
+        Point next = previous;
+        for (int k = 1; k <= 8; k++) {
+            Point p = current + neighbours[(back + k) % 8];
+            if (foreground(p)) {
+                next = p;
+                break;
+            }
+        }
+        points.push_back(current);
+        if (next == start && current == last) {
+            break;
+        }
+        previous = current;
+        current = next;
+    }
+    return compress(points);
+}
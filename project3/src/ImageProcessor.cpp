@@ -3,6 +3,9 @@
 #include <filesystem>
 #include <constants.h>
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <WorkStealingPool.h>
 
 using namespace cv;
 using namespace std;
@@ -10,7 +13,9 @@ using namespace std;
 ImageProcessor::ImageProcessor() : N1(0), N2(0) {}
 
 void ImageProcessor::loadImages(const string& path) {
-    files = getFiles(path);
+    // Scan the class directories once, later changes are applied by refreshFiles
+    directory = make_unique<DirectoryIndex>(path, nullptr, 1);
+    files = directory->files();
     
     if (!files.empty()) {
         // assuming the first file is the target
@@ -39,36 +44,90 @@ void ImageProcessor::displayImages(int num) {
             cerr << "Invalid image number." << endl;
             return;
         }
-        img = imread(files[num-1]);
-
-        if (img.empty()) {
-            cerr << "Failed to load image." << endl;
-            return;
+        // Decode jobs of the previously selected image are stale now
+        loader.cancelPending();
+        requestTime = Profiler::Clock::now();
+        pendingNumber = num;
+        pendingImage = loader.load(files[num-1]);
+
+        for (int position = 0; position < 4; position++) {
+            drawPlaceholder(grid, position);
         }
-        // resize for display if necessary
-        displayImage = img.clone();
-        fillGrid(grid, displayImage, 0);
-        cv::Mat segmented = segmentGreenRegion(displayImage);
-        auto [boundaryImage, largestInnerContour] = findBoundaries(segmented);
-        cv::Mat rotatedImg = displayImage;
-        if (!largestInnerContour.empty()) {
-            // create a mask from the largest inner contour
-            cv::Mat mask = cv::Mat::zeros(img.size(), CV_8UC1);
-            cv::drawContours(mask, std::vector<std::vector<cv::Point>>{largestInnerContour}, -1, cv::Scalar(255), cv::FILLED);
-
-            // apply the mask to the original image
-            cv::Mat maskedImage;
-            displayImage.copyTo(maskedImage, mask);
+        showGrid();
+    }
+}
 
+void ImageProcessor::showPendingImages() {
+    if (pendingNumber == -1 || !AsyncImageLoader::isReady(pendingImage)) {
+        return;
+    }
+    img = pendingImage.get();
+    pendingNumber = -1;
 
-            rotatedImg = rotateToHorizontal(maskedImage, largestInnerContour); // Example rotation function
+    if (img.empty()) {
+        cerr << "Failed to load image." << endl;
+        return;
+    }
+    // resize for display if necessary
+    displayImage = img.clone();
+    fillGrid(grid, displayImage, 0);
+    cv::Mat segmented;
+    {
+        ScopedTimer timer("segmentation");
+        segmented = segmentGreenRegion(displayImage, scratch);
+    }
+    cv::Mat boundaryImage;
+    std::vector<cv::Point> largestInnerContour;
+    {
+        ScopedTimer timer("boundaries");
+        std::tie(boundaryImage, largestInnerContour) = findBoundaries(scratch.contours, scratch.hierarchy, displayImage.size());
+    }
+    cv::Mat rotatedImg = displayImage;
+    if (!largestInnerContour.empty()) {
+        ScopedTimer timer("rotate");
+        cv::Mat crop = cropComponent(displayImage, largestInnerContour, scratch);
+
+        // The crop is as large as the component, center it in its grid cell and shrink it if it does not fit
+        rotatedImg = cv::Mat::zeros(N1, N2, displayImage.type());
+        double scale = std::min(1.0, std::min(double(N2) / crop.cols, double(N1) / crop.rows));
+        if (scale < 1.0) {
+            cv::resize(crop, crop, cv::Size(), scale, scale, cv::INTER_AREA);
         }
+        cv::Rect cell((N2 - crop.cols) / 2, (N1 - crop.rows) / 2, std::min(crop.cols, N2), std::min(crop.rows, N1));
+        crop(cv::Rect(0, 0, cell.width, cell.height)).copyTo(rotatedImg(cell));
+    }
+    {
+        ScopedTimer timer("composite");
         fillGrid(grid, segmented, 1);
         fillGrid(grid, boundaryImage, 2);
         fillGrid(grid, rotatedImg, 3);
+    }
 
-        imshow("Display", grid);
+    showGrid();
+    // Time from the request of the images until they are on screen
+    Profiler::instance().record("latency", requestTime, Profiler::Clock::now());
+}
+
+void ImageProcessor::showGrid() {
+    ScopedTimer timer("imshow");
+    if (!Profiler::instance().overlayEnabled()) {
+        imshow(constants::windowName, grid);
+        return;
     }
+    // Draw the overlay on a copy so that the grid stays clean
+    grid.copyTo(overlayBuffer);
+    Profiler::instance().drawOverlay(overlayBuffer);
+    imshow(constants::windowName, overlayBuffer);
+}
+
+void ImageProcessor::drawPlaceholder(Mat& grid, int position) {
+    Mat targetROI = grid(Rect((position % 2) * N2, (position / 2) * N1, N2, N1));
+    targetROI.setTo(Scalar(40, 40, 40));
+
+    int baseline = 0;
+    Size textSize = getTextSize(constants::loadingMessage, FONT_HERSHEY_SIMPLEX, 0.75, 2, &baseline);
+    Point textOrg((N2 - textSize.width) / 2, (N1 + textSize.height) / 2);
+    putText(targetROI, constants::loadingMessage, textOrg, FONT_HERSHEY_SIMPLEX, 0.75, Scalar(255, 255, 255), 2);
 }
 
 
@@ -77,26 +136,12 @@ void ImageProcessor::fillGrid(Mat& grid, const Mat& img, int position) {
     img.copyTo(targetROI);
 }
 
-vector<string> ImageProcessor::getFiles(const string& path) {
-    vector<string> files;
-    try {
-        if (!filesystem::exists(path)) {
-            cerr << "ERROR: Path does not exist. Correct it in constants.h file" << endl;
-            return files;
-        }
-        // Iterate over the folders and add the files to the vector
-        for (const auto& entry : filesystem::directory_iterator(path)) {
-            for (const auto& file : filesystem::directory_iterator(entry.path())) {
-                files.push_back(file.path().string());
-            }
-        }
-
-        std::sort(files.begin(), files.end());
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << e.what() << endl;
-        return files;
+void ImageProcessor::refreshFiles() {
+    if (!directory || !directory->poll()) {
+        return;
     }
-    return files;
+    files = directory->files();
+    cout << "Data directory changed, " << files.size() << " images" << endl;
 }
 
 
@@ -137,15 +182,22 @@ cv::Mat ImageProcessor::createWelcomeScreen(const std::vector<std::string>& mess
 
 void ImageProcessor::run() {
     namedWindow(constants::windowName, WINDOW_AUTOSIZE);
-    imshow(constants::windowName, grid);
+    showGrid();
 
     while (true) {
         int number = -1;
-        char key = waitKey(0);
+        char key = waitForKey();
         if (key == 'q') break;
         else if (key == 13 || key == 10) {
             displayImages(selectedImage);
         } 
+        else if (key == 'h') {
+            Profiler::instance().toggleOverlay();
+            showGrid();
+        }
+        else if (key == 't') {
+            Profiler::instance().writeTrace(constants::traceFile);
+        }
         // Move with a and d keys
         else if (key == 'a') {
             selectedImage -= 1;
@@ -163,7 +215,7 @@ void ImageProcessor::run() {
 
             // Continue to capture digits until Enter is pressed
             while(true) {
-                key = waitKey(0);
+                key = waitForKey();
                 if (key == 13 || key == 10) { // If Enter is pressed, break
                     number = atoi(numberStr.c_str());
                     selectedImage = number;
@@ -180,6 +232,18 @@ void ImageProcessor::run() {
     }
 }
 
+char ImageProcessor::waitForKey() {
+    while (true) {
+        int key = waitKey(constants::pollDelay);
+        if (key != -1) {
+            return key;
+        }
+        // Show the images that finished decoding while no key is pressed
+        refreshFiles();
+        showPendingImages();
+    }
+}
+
 int ImageProcessor::extractNumber(const string& filename) {
     size_t lastSlash = filename.find_last_of("/\\");
     size_t start = lastSlash == string::npos ? 0 : lastSlash + 1;
@@ -197,59 +261,32 @@ int ImageProcessor::extractNumber(const string& filename) {
     return numericString.empty() ? 0 : stoi(numericString);
 }
 
-cv::Mat ImageProcessor::segmentGreenRegion(const cv::Mat& img) {
-    cv::Mat hsvImg, greenMask, segmented;
-
-    // Convert the image from BGR to HSV color space
-    cv::cvtColor(img, hsvImg, cv::COLOR_BGR2HSV);
+cv::Mat ImageProcessor::segmentGreenRegion(const cv::Mat& img, Scratch& scratch) {
+    // Pixels in the green range of HSV, computed from BGR in one pass
+    hsvRangeMask(img, constants::SegLowLimit, constants::SegHighLimit, scratch.greenMask);
 
-    // Define the range of green color in HSV
-    cv::inRange(hsvImg, constants::SegLowLimit, constants::SegHighLimit, greenMask); // Adjust these values as needed
+    // Close to fill small holes and gaps in the segmented area, then open to remove small noise.
+    // The operations ping-pong between two buffers instead of allocating temporaries.
+    static const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(5, 5));
+    cv::dilate(scratch.greenMask, scratch.morphology, kernel);
+    cv::erode(scratch.morphology, scratch.greenMask, kernel);
+    cv::erode(scratch.greenMask, scratch.morphology, kernel);
+    cv::dilate(scratch.morphology, scratch.greenMask, kernel);
 
-    // Optional: Apply morphological operations to clean up the mask
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(5, 5));
-    cv::morphologyEx(greenMask, greenMask, cv::MORPH_CLOSE, kernel); // Close operation to fill small holes and gaps in the segmented area
-    cv::morphologyEx(greenMask, greenMask, cv::MORPH_OPEN, kernel); // Open operation to remove small noise
-
-    // Find connected components
-    cv::Mat labels, stats, centroids;
-    int nLabels = cv::connectedComponentsWithStats(greenMask, labels, stats, centroids);
-
-    // Find the largest connected component (excluding the background)
-    int largestLabel = 1;
-    int largestArea = stats.at<int>(1, cv::CC_STAT_AREA);
-    for(int i = 2; i < nLabels; i++) {
-        int area = stats.at<int>(i, cv::CC_STAT_AREA);
-        if (area > largestArea) {
-            largestArea = area;
-            largestLabel = i;
-        }
-    }
-
-    // Create a mask for the largest component
-    cv::Mat largestComponentMask = (labels == largestLabel);
+    // Keep the largest connected component, with its boundaries
+    scratch.blobs.extract(scratch.greenMask, scratch.component, scratch.contours, scratch.hierarchy);
 
     // Apply the mask of the largest component to the original image to get the segmented green region
-    img.copyTo(segmented, largestComponentMask);
+    scratch.segmented.create(img.size(), img.type());
+    scratch.segmented.setTo(cv::Scalar::all(0));
+    img.copyTo(scratch.segmented, scratch.component);
 
-    return segmented;
+    return scratch.segmented;
 }
 
-std::pair<cv::Mat, std::vector<cv::Point>> ImageProcessor::findBoundaries(const cv::Mat& mask) {
-    cv::Mat singleChannelMask;
-    if (mask.channels() == 1 && mask.type() == CV_8UC1) {
-        singleChannelMask = mask;
-    } else {
-        cv::cvtColor(mask, singleChannelMask, cv::COLOR_BGR2GRAY);
-    }
-
-    cv::threshold(singleChannelMask, singleChannelMask, 0, 255, cv::THRESH_BINARY);
-
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
-    cv::findContours(singleChannelMask, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
-
-    cv::Mat boundaryImage = cv::Mat::zeros(singleChannelMask.size(), CV_8UC3);
+std::pair<cv::Mat, std::vector<cv::Point>> ImageProcessor::findBoundaries(const std::vector<std::vector<cv::Point>>& contours,
+                                                                          const std::vector<cv::Vec4i>& hierarchy, cv::Size size) {
+    cv::Mat boundaryImage = cv::Mat::zeros(size, CV_8UC3);
 
     double maxInnerArea = 0;
     int maxInnerIndex = -1;
@@ -277,8 +314,9 @@ std::pair<cv::Mat, std::vector<cv::Point>> ImageProcessor::findBoundaries(const
 }
 
 cv::Mat ImageProcessor::rotateToHorizontal(const cv::Mat& img, const std::vector<cv::Point>& contour) {
+    cv::Rect roi = cv::boundingRect(contour) & cv::Rect(0, 0, img.cols, img.rows);
     if (contour.size() < 4) {
-        return img;
+        return img(roi).clone();
     }
     cv::RotatedRect rotatedRect = cv::minAreaRect(contour);
 
@@ -288,58 +326,253 @@ cv::Mat ImageProcessor::rotateToHorizontal(const cv::Mat& img, const std::vector
         angle += 90.0; // Adjust the angle for tall rectangles
     }
 
-    // Step 4: Rotate the image around the center of the rectangle to make it horizontal
+    // Step 4: Rotate the rectangle around its center to make it horizontal, into an output just as large as the rectangle.
+    // The rectangle spans the centers of the contour pixels, so the output is one pixel larger to keep the border pixels.
+    float longSide = std::max(rotatedRect.size.width, rotatedRect.size.height);
+    float shortSide = std::min(rotatedRect.size.width, rotatedRect.size.height);
+    cv::Size cropSize(cvCeil(longSide) + 1, cvCeil(shortSide) + 1);
     cv::Mat rotationMatrix = cv::getRotationMatrix2D(rotatedRect.center, angle, 1.0);
+    cv::Matx23d M = rotationMatrix;
+
+    // Move the center of the rectangle to the center of the crop, and read the source from the bounding rectangle only
+    M(0, 2) += (cropSize.width - 1) / 2.0 - rotatedRect.center.x + M(0, 0) * roi.x + M(0, 1) * roi.y;
+    M(1, 2) += (cropSize.height - 1) / 2.0 - rotatedRect.center.y + M(1, 0) * roi.x + M(1, 1) * roi.y;
     cv::Mat rotatedImg;
-    cv::warpAffine(img, rotatedImg, rotationMatrix, img.size(), cv::INTER_CUBIC);
+    cv::warpAffine(img(roi), rotatedImg, M, cropSize, cv::INTER_CUBIC);
 
     return rotatedImg;
 }
 
-#include <filesystem>
+cv::Mat ImageProcessor::extractComponent(const cv::Mat& img, Scratch& scratch) {
+    segmentGreenRegion(img, scratch);
+    auto [boundaryImage, largestInnerContour] = findBoundaries(scratch.contours, scratch.hierarchy, img.size());
+    if (largestInnerContour.empty()) {
+        return cv::Mat();
+    }
 
-void ImageProcessor::processAllImages(const std::string& DataPath, const std::string& OutputPath) {
-    for (const auto& classEntry : std::filesystem::directory_iterator(DataPath)) {
-        std::string className = classEntry.path().filename().string();
-        std::string outputDir = OutputPath + "/" + className;
-        std::filesystem::create_directories(outputDir);
+    return cropComponent(img, largestInnerContour, scratch);
+}
 
-        int processedImagesCount = 0; // Count of successfully processed images
+cv::Mat ImageProcessor::cropComponent(const cv::Mat& img, const std::vector<cv::Point>& contour, Scratch& scratch) {
+    // Only the bounding rectangle of the contour is masked, the rotation reads nothing outside of it
+    cv::Rect roi = cv::boundingRect(contour) & cv::Rect(0, 0, img.cols, img.rows);
+    scratch.mask.create(roi.size(), CV_8UC1);
+    scratch.mask.setTo(cv::Scalar::all(0));
+    cv::drawContours(scratch.mask, std::vector<std::vector<cv::Point>>{contour}, -1, cv::Scalar(255), cv::FILLED,
+                     cv::LINE_8, cv::noArray(), INT_MAX, -roi.tl());
+
+    // The buffers keep their allocation while the image size does not change
+    scratch.maskedImage.create(img.size(), img.type());
+    cv::Mat masked = scratch.maskedImage(roi);
+    masked.setTo(cv::Scalar::all(0));
+    img(roi).copyTo(masked, scratch.mask);
+
+    return rotateToHorizontal(scratch.maskedImage, contour);
+}
 
-        for (const auto& imageEntry : std::filesystem::directory_iterator(classEntry.path())) {
-            cv::Mat img = cv::imread(imageEntry.path().string());
-            if (img.empty()) {
-                std::cerr << "Warning: Could not read image: " << imageEntry.path() << std::endl;
-                continue; // Skip processing this image
+void ImageProcessor::hsvRangeMask(const Mat& bgr, const Scalar& low, const Scalar& high, Mat& mask) {
+    if (bgr.type() != CV_8UC3) {
+        Mat hsv;
+        cvtColor(bgr, hsv, COLOR_BGR2HSV);
+        inRange(hsv, low, high, mask);
+        return;
+    }
+    // OpenCV's 8-bit BGR to HSV conversion divides with the fixed-point tables
+    // (255 << 12) / v and (180 << 12) / (6 * diff), rounded. For 8-bit values the float quotients
+    // rounded half up give exactly the same tables, so every pixel gets the hue and saturation
+    // cvtColor gives it, without table lookups.
+    const int shift = 12, half = 1 << (shift - 1);
+    const float saturationScale = 255 << shift, hueScale = 30 << shift;
+
+    mask.create(bgr.size(), CV_8UC1);
+    // inRange rounds the bounds of 8-bit images to integers
+    const int hueLow = cvRound(low[0]), hueHigh = cvRound(high[0]);
+    const int saturationLow = cvRound(low[1]), saturationHigh = cvRound(high[1]);
+    const int valueLow = cvRound(low[2]), valueHigh = cvRound(high[2]);
+    parallel_for_(Range(0, bgr.rows), [&](const Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const uchar* pixels = bgr.ptr<uchar>(y);
+            uchar* row = mask.ptr<uchar>(y);
+            int x = 0;
+#if (CV_VERSION_MAJOR > 4 || CV_VERSION_MINOR >= 9) && (CV_SIMD || CV_SIMD_SCALABLE)
+            // The compiler cannot vectorize the interleaved channels, so the loop is written with
+            // universal intrinsics: every 8-bit lane is widened to 32 bits and tested in 4 parts
+            const v_int32 one = vx_setall_s32(1), halves = vx_setall_s32(half), hues = vx_setall_s32(180);
+            const v_float32 saturationScales = vx_setall_f32(saturationScale), hueScales = vx_setall_f32(hueScale);
+            const v_float32 rounding = vx_setall_f32(0.5f);
+            const v_int32 hueLows = vx_setall_s32(hueLow), hueHighs = vx_setall_s32(hueHigh);
+            const v_int32 saturationLows = vx_setall_s32(saturationLow), saturationHighs = vx_setall_s32(saturationHigh);
+            const v_int32 valueLows = vx_setall_s32(valueLow), valueHighs = vx_setall_s32(valueHigh);
+            auto inside = [&](const v_int32& b, const v_int32& g, const v_int32& r) {
+                v_int32 v = v_max(v_max(b, g), r);
+                v_int32 diff = v_sub(v, v_min(v_min(b, g), r));
+                v_int32 saturationDivisor = v_trunc(v_add(v_div(saturationScales, v_cvt_f32(v_max(v, one))), rounding));
+                v_int32 hueDivisor = v_trunc(v_add(v_div(hueScales, v_cvt_f32(v_max(diff, one))), rounding));
+                v_int32 saturation = v_shr<shift>(v_add(v_mul(diff, saturationDivisor), halves));
+                // Red wins ties with green, green wins ties with blue, like in cvtColor
+                v_int32 hue = v_select(v_eq(v, r), v_sub(g, b),
+                                       v_select(v_eq(v, g), v_add(v_sub(b, r), v_add(diff, diff)),
+                                                v_add(v_sub(r, g), v_shl<2>(diff))));
+                hue = v_shr<shift>(v_add(v_mul(hue, hueDivisor), halves));
+                hue = v_add(hue, v_and(v_lt(hue, vx_setzero_s32()), hues));
+                return v_and(v_and(v_and(v_ge(hue, hueLows), v_le(hue, hueHighs)),
+                                   v_and(v_ge(saturation, saturationLows), v_le(saturation, saturationHighs))),
+                             v_and(v_ge(v, valueLows), v_le(v, valueHighs)));
+            };
+            const int lanes = VTraits<v_uint8>::vlanes();
+            for (; x <= bgr.cols - lanes; x += lanes) {
+                v_uint8 b8, g8, r8;
+                v_load_deinterleave(pixels + 3 * x, b8, g8, r8);
+                v_uint16 b16[2], g16[2], r16[2];
+                v_expand(b8, b16[0], b16[1]);
+                v_expand(g8, g16[0], g16[1]);
+                v_expand(r8, r16[0], r16[1]);
+                v_int16 masks[2];
+                for (int k = 0; k < 2; k++) {
+                    v_uint32 b32[2], g32[2], r32[2];
+                    v_expand(b16[k], b32[0], b32[1]);
+                    v_expand(g16[k], g32[0], g32[1]);
+                    v_expand(r16[k], r32[0], r32[1]);
+                    masks[k] = v_pack(inside(v_reinterpret_as_s32(b32[0]), v_reinterpret_as_s32(g32[0]), v_reinterpret_as_s32(r32[0])),
+                                      inside(v_reinterpret_as_s32(b32[1]), v_reinterpret_as_s32(g32[1]), v_reinterpret_as_s32(r32[1])));
+                }
+                // The masks are 0 or -1, which packs to 0 or 255
+                v_store(row + x, v_reinterpret_as_u8(v_pack(masks[0], masks[1])));
             }
-
-            // Apply your processing
-            cv::Mat segmented = segmentGreenRegion(img); // Placeholder for actual segmentation function
-            auto [boundaryImage, largestInnerContour] = findBoundaries(segmented); // Placeholder for actual boundary detection
-
-            if (largestInnerContour.empty()) {
-                std::cerr << "Warning: No contour found in image: " << imageEntry.path() << std::endl;
-                continue; // Skip processing this image
+#endif
+            for (; x < bgr.cols; x++) {
+                int b = pixels[3 * x], g = pixels[3 * x + 1], r = pixels[3 * x + 2];
+                int v = std::max(std::max(b, g), r);
+                int diff = v - std::min(std::min(b, g), r);
+                int saturationDivisor = int(saturationScale / std::max(v, 1) + 0.5f);
+                int hueDivisor = int(hueScale / std::max(diff, 1) + 0.5f);
+                int saturation = (diff * saturationDivisor + half) >> shift;
+                int hue = v == r ? g - b : v == g ? b - r + 2 * diff : r - g + 4 * diff;
+                hue = (hue * hueDivisor + half) >> shift;
+                hue += hue < 0 ? 180 : 0;
+                bool inside = (hue >= hueLow) & (hue <= hueHigh) & (saturation >= saturationLow) &
+                              (saturation <= saturationHigh) & (v >= valueLow) & (v <= valueHigh);
+                row[x] = inside ? 255 : 0;
             }
-
-            cv::Mat mask = cv::Mat::zeros(img.size(), CV_8UC1);
-            cv::drawContours(mask, std::vector<std::vector<cv::Point>>{largestInnerContour}, -1, cv::Scalar(255), cv::FILLED);
-
-            cv::Mat maskedImage;
-            img.copyTo(maskedImage, mask);
-
-            cv::Mat rotatedImg = rotateToHorizontal(maskedImage, largestInnerContour); // Placeholder for actual rotation function
-            
-            std::string outputPath = outputDir + "/" + imageEntry.path().filename().string();
-            cv::imwrite(outputPath, rotatedImg);
-
-            processedImagesCount++;
         }
+    });
+}
 
-        // Delete the folder if less than 2 images were processed
-        if (processedImagesCount < 2) {
-            std::filesystem::remove_all(outputDir);
-            std::cout << "Removed directory due to insufficient processed images: " << outputDir << std::endl;
+void ImageProcessor::processAllImages(const std::string& DataPath, const std::string& OutputPath,
+                                      const ComponentCallback& onComponent) {
+    /**
+     * @brief The progress of a class, shared by the threads processing its images.
+     */
+    struct ClassState {
+        std::string name; ///< Name of the class directory.
+        std::string outputDir; ///< Directory the processed images of the class are written to, empty if they are not saved.
+        std::atomic<int> remaining{0}; ///< Number of images not finished yet.
+        std::atomic<int> processed{0}; ///< Number of successfully processed images.
+    };
+    // Counts an image of a class as finished when its job ends, also if the job throws.
+    // The thread finishing the last image of the class decides about its directory,
+    // all other images of the class are written by then
+    struct ImageFinisher {
+        ClassState* state; ///< Class of the image.
+        ~ImageFinisher() {
+            if (--state->remaining == 0 && !state->outputDir.empty() && state->processed < constants::minClassImages) {
+                std::error_code error;
+                // A destructor must not throw, so the error is reported instead
+                std::filesystem::remove_all(state->outputDir, error);
+                if (error) {
+                    std::cerr << "Warning: Could not remove directory: " + state->outputDir + "\n";
+                } else {
+                    std::cout << "Removed directory due to insufficient processed images: " + state->outputDir + "\n";
+                }
+            }
+        }
+    };
+    // Every image runs on its own core, OpenCV's inner parallelism would only oversubscribe them.
+    // The previous thread count is restored also if a job throws
+    struct SingleThreadedOpenCV {
+        int previous = cv::getNumThreads(); ///< Thread count to restore.
+        SingleThreadedOpenCV() { cv::setNumThreads(1); }
+        ~SingleThreadedOpenCV() { cv::setNumThreads(previous); }
+    };
+    auto start = Profiler::Clock::now();
+    bool save = !OutputPath.empty();
+
+    // List every image first, so the pool can balance the work across all classes.
+    // Sorting gives every image a stable index, whatever order the directories are listed in.
+    std::vector<std::filesystem::path> classPaths;
+    for (const auto& classEntry : std::filesystem::directory_iterator(DataPath)) {
+        if (classEntry.is_directory()) {
+            classPaths.push_back(classEntry.path());
+        }
+    }
+    std::sort(classPaths.begin(), classPaths.end());
+
+    std::vector<std::unique_ptr<ClassState>> classes;
+    std::vector<std::pair<std::filesystem::path, ClassState*>> images;
+    for (const auto& classPath : classPaths) {
+        auto state = std::make_unique<ClassState>();
+        state->name = classPath.filename().string();
+        std::vector<std::filesystem::path> imagePaths;
+        for (const auto& imageEntry : std::filesystem::directory_iterator(classPath)) {
+            imagePaths.push_back(imageEntry.path());
+        }
+        std::sort(imagePaths.begin(), imagePaths.end());
+        if (imagePaths.empty()) {
+            continue;
+        }
+        if (save) {
+            state->outputDir = OutputPath + "/" + state->name;
+            std::filesystem::create_directories(state->outputDir);
         }
+        for (const auto& imagePath : imagePaths) {
+            images.emplace_back(imagePath, state.get());
+        }
+        state->remaining = imagePaths.size();
+        classes.push_back(std::move(state));
     }
+
+    WorkStealingPool pool;
+    std::vector<Scratch> scratch(pool.size());
+    std::vector<WorkStealingPool::Job> jobs;
+    for (int index = 0; index < (int)images.size(); index++) {
+        jobs.push_back([this, &scratch, &onComponent, &imagePath = images[index].first, state = images[index].second,
+                        index](unsigned int worker) {
+            ImageFinisher finisher{state};
+            cv::Mat img;
+            {
+                ScopedTimer timer("decode");
+                img = cv::imread(imagePath.string());
+            }
+            if (img.empty()) {
+                std::cerr << "Warning: Could not read image: " + imagePath.string() + "\n";
+            } else {
+                cv::Mat rotatedImg;
+                {
+                    ScopedTimer timer("extract");
+                    rotatedImg = extractComponent(img, scratch[worker]);
+                }
+                if (rotatedImg.empty()) {
+                    std::cerr << "Warning: No contour found in image: " + imagePath.string() + "\n";
+                } else {
+                    if (!state->outputDir.empty()) {
+                        ScopedTimer timer("write");
+                        cv::imwrite(state->outputDir + "/" + imagePath.filename().string(), rotatedImg);
+                    }
+                    if (onComponent) {
+                        onComponent(index, state->name, rotatedImg);
+                    }
+                    state->processed++;
+                }
+            }
+        });
+    }
+
+    {
+        SingleThreadedOpenCV singleThreaded;
+        pool.run(std::move(jobs));
+    }
+
+    double seconds = std::chrono::duration<double>(Profiler::Clock::now() - start).count();
+    std::cout << "Processed " << images.size() << " images of " << classes.size() << " classes on " << pool.size()
+              << " threads in " << seconds << " s." << std::endl;
 }
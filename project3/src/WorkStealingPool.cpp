@@ -0,0 +1,81 @@
+#include <WorkStealingPool.h>
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(unsigned int numThreads) : numThreads(numThreads) {
+    if (this->numThreads == 0) {
+        this->numThreads = max(1u, thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < this->numThreads; i++) {
+        queues.push_back(make_unique<Queue>());
+    }
+}
+
+void WorkStealingPool::run(vector<Job> jobs) {
+    // Hand every worker a contiguous block of the jobs
+    for (unsigned int worker = 0; worker < numThreads; worker++) {
+        size_t begin = jobs.size() * worker / numThreads;
+        size_t end = jobs.size() * (worker + 1) / numThreads;
+        Queue& queue = *queues[worker];
+        lock_guard<mutex> lock(queue.mutex);
+        for (size_t i = begin; i < end; i++) {
+            queue.jobs.push_back(std::move(jobs[i]));
+        }
+    }
+
+    exception_ptr error;
+    mutex errorMutex;
+    vector<thread> workers;
+    for (unsigned int worker = 1; worker < numThreads; worker++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, worker, ref(error), ref(errorMutex));
+    }
+    // The calling thread is the first worker
+    workerLoop(0, error, errorMutex);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+bool WorkStealingPool::take(unsigned int worker, Job& job) {
+    {
+        Queue& own = *queues[worker];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.front());
+            own.jobs.pop_front();
+            return true;
+        }
+    }
+    // Steal from the back, which is farthest from the jobs the owner is working on
+    for (unsigned int i = 1; i < numThreads; i++) {
+        Queue& victim = *queues[(worker + i) % numThreads];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.back());
+            victim.jobs.pop_back();
+            return true;
+        }
+    }
+    // No jobs are added during a run, so empty queues stay empty
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned int worker, exception_ptr& error, mutex& errorMutex) {
+    Job job;
+    while (take(worker, job)) {
+        try {
+            job(worker);
+        } catch (...) {
+            lock_guard<mutex> lock(errorMutex);
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    }
+}
@@ -1,15 +1,37 @@
 #include <iostream>
+#include <string>
+#include <thread>
 #include <ImageProcessor.h>
 #include <BagOfWords.h>
+#include <BoundedQueue.h>
 #include <constants.h>
 
-int main() {
+int main(int argc, char** argv) {
+    // --save also writes the processed images to the output path
+    bool save = argc > 1 && std::string(argv[1]) == "--save";
+
+    // The segmented components go straight to the feature extraction, both stages run at the same time
+    BoundedQueue<ImageWithLabel> components(constants::componentQueueSize);
     ImageProcessor processor;
-    processor.processAllImages(constants::dataPath, constants::outputPath); // Adjust the path as necessary
+    std::thread segmentation([&] {
+        try {
+            processor.processAllImages(constants::dataPath, save ? constants::outputPath : "",
+                                       [&](int index, const std::string& className, const cv::Mat& component) {
+                                           components.push({component, className, index});
+                                       });
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+        components.close();
+    });
     BagOfWords bow;
-    cv::Mat similarity_matrix = bow.run(constants::outputPath); // Adjust the path as necessary
-    
+    cv::Mat similarity_matrix = bow.run(components);
+    segmentation.join();
+    if (similarity_matrix.empty()) {
+        return 1;
+    }
+
     // Comment out the following line if you don't want to visualize the similarity matrix
     bow.visualizeSimilarityMatrix(similarity_matrix);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,55 @@
+/**
+ * @file HsvRangeMaskTest.cpp
+ * @brief Compares ImageProcessor::hsvRangeMask with cv::cvtColor and cv::inRange on every 8-bit BGR colour.
+ *
+ * A 4096x4096 image holds each of the 2^24 colours once. The test fails if the mask of any colour differs
+ * from the reference for the segmentation range or any of a few other ranges, including fractional bounds
+ * and hues outside the green range.
+ */
+
+#include <ImageProcessor.h>
+#include <constants.h>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+int main() {
+    Mat colours(4096, 4096, CV_8UC3);
+    for (int y = 0; y < colours.rows; y++) {
+        Vec3b* row = colours.ptr<Vec3b>(y);
+        for (int x = 0; x < colours.cols; x++) {
+            int colour = y * colours.cols + x;
+            row[x] = Vec3b(colour & 255, (colour >> 8) & 255, colour >> 16);
+        }
+    }
+    Mat hsv;
+    cvtColor(colours, hsv, COLOR_BGR2HSV);
+
+    const vector<pair<Scalar, Scalar>> ranges = {
+        {constants::SegLowLimit, constants::SegHighLimit},
+        {Scalar(0, 0, 0), Scalar(180, 255, 255)},
+        {Scalar(0, 50, 50), Scalar(10, 255, 255)},
+        {Scalar(170, 1, 1), Scalar(179, 254, 254)},
+        {Scalar(29.6, 30.4, 64.5), Scalar(90.5, 200.2, 255)},
+        {Scalar(30, 0, 0), Scalar(30, 255, 255)},
+        {Scalar(60, 255, 0), Scalar(60, 255, 255)},
+    };
+    int failures = 0;
+    for (const auto& [low, high] : ranges) {
+        Mat expected, mask, different;
+        inRange(hsv, low, high, expected);
+        ImageProcessor::hsvRangeMask(colours, low, high, mask);
+        compare(mask, expected, different, CMP_NE);
+        int mismatches = countNonZero(different);
+        cout << "Range " << low << " - " << high << ": " << mismatches << " mismatches" << endl;
+        if (mismatches > 0) {
+            vector<Point> locations;
+            findNonZero(different, locations);
+            Vec3b colour = colours.at<Vec3b>(locations[0]);
+            cerr << "First mismatch: BGR " << colour << ", HSV " << hsv.at<Vec3b>(locations[0]) << endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -12,7 +12,11 @@
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
+#include <memory>
 #include <constants.h>
+#include <AsyncImageLoader.h>
+#include <DirectoryIndex.h>
+#include <Profiler.h>
 
 /**
  * @class ImageFlow
@@ -43,6 +47,8 @@ private:
     int selectedImage = -1; ///< Index of the currently selected image.
     std::vector<std::string> files; ///< List of image file paths.
     std::vector<std::string> mask_files; ///< List of image masks file paths.
+    std::unique_ptr<DirectoryIndex> directory; ///< Live index of the data directory.
+    std::string maskPath; ///< Path to the directory containing the masks.
 
     cv::Mat img; ///< First image.
     cv::Mat img2; ///< Second image.
@@ -51,8 +57,16 @@ private:
     cv::Mat displayImage; ///< Resized image for display.
     cv::Mat displayImage2; ///< Resized image2 for display.
     cv::Mat grid; ///< Grid to display the images.
+    cv::Mat overlayBuffer; ///< Copy of the grid with the timing overlay drawn on it.
+    Profiler::Clock::time_point requestTime; ///< Time the shown images were requested, for the display latency.
     int N1, N2; ///< Dimensions of the image grid.
     std::string path; ///< Path to the directory containing images.
+    AsyncImageLoader loader; ///< Worker pool decoding the images and masks.
+    std::shared_future<cv::Mat> pendingImage; ///< First image being decoded for display.
+    std::shared_future<cv::Mat> pendingImage2; ///< Second image being decoded for display.
+    std::shared_future<cv::Mat> pendingMask; ///< Mask of the first image being decoded.
+    std::shared_future<cv::Mat> pendingMask2; ///< Mask of the second image being decoded.
+    int pendingNumber = -1; ///< Number of the image pair being decoded, -1 if none.
 
     /**
      * @brief Displays images in a grid format.
@@ -60,6 +74,29 @@ private:
      */
     void displayImages(int num);
 
+    /**
+     * @brief Processes and shows the pending images once they are decoded.
+     */
+    void showPendingImages();
+
+    /**
+     * @brief Shows the grid in the window, with the timing overlay if it is enabled.
+     */
+    void showGrid();
+
+    /**
+     * @brief Draws a placeholder into a grid cell while its image is being decoded.
+     * @param grid The grid where the placeholder will be drawn.
+     * @param position The position in the grid where the placeholder will be drawn.
+     */
+    void drawPlaceholder(cv::Mat &grid, int position);
+
+    /**
+     * @brief Waits for a key press while showing the images that finish decoding.
+     * @return The pressed key.
+     */
+    char waitForKey();
+
     /**
      * @brief Creates a welcome screen with messages.
      * @param messages The messages to display on the welcome screen.
@@ -78,11 +115,16 @@ private:
     void fillGrid(cv::Mat &grid, const cv::Mat &img, int position);
 
     /**
-     * @brief Retrieves the list of files from a specified directory.
-     * @param path The path to the directory.
-     * @return 2 vector of strings containing the image and mask paths respectively.
+     * @brief Applies the files added to or removed from the data directory to the file list.
+     */
+    void refreshFiles();
+
+    /**
+     * @brief Builds the mask file paths of the image files.
+     * @param files The image file paths.
+     * @return The mask file paths, in the order of the image files.
      */
-    std::pair<std::vector<std::string>, std::vector<std::string>> getFiles(const std::string &path, const std::string& mask_path);
+    std::vector<std::string> getMaskFiles(const std::vector<std::string>& files) const;
 
     /**
      * @brief Applies mask to the image.
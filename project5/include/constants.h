@@ -2,12 +2,17 @@
 #define CONSTANTS_H
 
 #include <string>
+#include <vector>
+#include <CommonConstants.h>
 namespace constants {
     const std::string dataPath = "../Data/tum_freiburg3_sitting_static";
     const std::string dataMaskpath = "../Data/tum_freiburg3_sitting_static/masks";
-    const std::vector<std::string> welcomeMessage = {"Welcome to the Optical Flow Interface","Write the image number and press Enter to display the image.","Press 'q' to quit.", "Then press enter" ,"Prepared by: Ahmet Furkan Akinci"};
+    const std::vector<std::string> welcomeMessage = {"Welcome to the Optical Flow Interface","Write the image number and press Enter to display the image.","Press 'q' to quit.", "Then press enter" , "Press 'h' for stage timings, 't' to save them as a trace","Prepared by: Ahmet Furkan Akinci"};
     const int lineThickness = 4;
     const int minAreaThreshold = 500;
+    constexpr int pollDelay = 15; // Milliseconds to wait for a key press before checking pending decodes
+    const std::string loadingMessage = "Loading...";
+    const std::string traceFile = "trace.json"; // Chrome trace written when 't' is pressed
 }
 
 #endif // CONSTANTS_H
\ No newline at end of file
@@ -12,10 +12,11 @@ ImageFlow::ImageFlow() : N1(0), N2(0) {}
 
 // Load images from the specified paths
 void ImageFlow::loadImages(const string& path, const string& mask_path) {
-    // Get all image and mask file paths
-    std::pair<std::vector<string>, std::vector<string>> all_files = getFiles(path, mask_path);
-    files = all_files.first;
-    mask_files = all_files.second;
+    // Index the images once, later changes are applied by refreshFiles
+    directory = make_unique<DirectoryIndex>(path, [this](const string& file) { return extractNumber(file); });
+    maskPath = mask_path;
+    files = directory->files();
+    mask_files = getMaskFiles(files);
     
     if (!files.empty()) {
         // Load the first image
@@ -49,33 +50,92 @@ void ImageFlow::displayImages(int num) {
             return;
         }
 
-        // Load images and masks
-        img = imread(files[num-1]);
-        img2 = imread(files[num]);
-        mask_img = imread(mask_files[num-1], IMREAD_GRAYSCALE);
-        mask_img2 = imread(mask_files[num], IMREAD_GRAYSCALE);
+        // Decode jobs of the previously selected images are stale now
+        loader.cancelPending();
+        requestTime = Profiler::Clock::now();
+        pendingNumber = num;
+        pendingImage = loader.load(files[num-1]);
+        pendingImage2 = loader.load(files[num]);
+        pendingMask = loader.load(mask_files[num-1], IMREAD_GRAYSCALE);
+        pendingMask2 = loader.load(mask_files[num], IMREAD_GRAYSCALE);
+
+        // Show placeholders until the images are decoded
+        for (int position = 0; position < 4; position++) {
+            drawPlaceholder(grid, position);
+        }
+        showGrid();
+    }
+}
 
-        // Apply mask to the first image
-        cv::Mat img_masked = applyMask(mask_img, img);
+// Process and show the pending images once they are decoded
+void ImageFlow::showPendingImages() {
+    if (pendingNumber == -1 || !AsyncImageLoader::isReady(pendingImage) || !AsyncImageLoader::isReady(pendingImage2) ||
+        !AsyncImageLoader::isReady(pendingMask) || !AsyncImageLoader::isReady(pendingMask2)) {
+        return;
+    }
+    img = pendingImage.get();
+    img2 = pendingImage2.get();
+    mask_img = pendingMask.get();
+    mask_img2 = pendingMask2.get();
+    pendingNumber = -1;
+
+    if (img.empty() || img2.empty()) {
+        cerr << "Failed to load image." << endl;
+        return;
+    }
 
-        if (img.empty() || img2.empty()) {
-            cerr << "Failed to load image." << endl;
-            return;
-        }
+    // Clone images for display
+    displayImage = img.clone();
+    displayImage2 = img2.clone();
+    
+    // Run the processing stages
+    Mat flowImage, trackingImage;
+    {
+        ScopedTimer timer("optical flow");
+        flowImage = applyOpticalFlow();
+    }
+    {
+        ScopedTimer timer("tracking");
+        trackingImage = applyTracking();
+    }
 
-        // Clone images for display
-        displayImage = img.clone();
-        displayImage2 = img2.clone();
-        
-        // Fill the grid with images and processed results
+    // Fill the grid with images and processed results
+    {
+        ScopedTimer timer("composite");
         fillGrid(grid, displayImage, 0);
         fillGrid(grid, displayImage2, 1);
-        fillGrid(grid, applyOpticalFlow(), 2);
-        fillGrid(grid, applyTracking(), 3);  
+        fillGrid(grid, flowImage, 2);
+        fillGrid(grid, trackingImage, 3);
+    }
 
-        // Show the grid
+    // Show the grid
+    showGrid();
+    // Time from the request of the images until they are on screen
+    Profiler::instance().record("latency", requestTime, Profiler::Clock::now());
+}
+
+// Show the grid, with the timing overlay if it is enabled
+void ImageFlow::showGrid() {
+    ScopedTimer timer("imshow");
+    if (!Profiler::instance().overlayEnabled()) {
         imshow("Display", grid);
+        return;
     }
+    // Draw the overlay on a copy so that the grid stays clean
+    grid.copyTo(overlayBuffer);
+    Profiler::instance().drawOverlay(overlayBuffer);
+    imshow("Display", overlayBuffer);
+}
+
+// Draw a placeholder into a grid cell while its image is being decoded
+void ImageFlow::drawPlaceholder(Mat& grid, int position) {
+    Mat targetROI = grid(Rect((position % 2) * N2, (position / 2) * N1, N2, N1));
+    targetROI.setTo(Scalar(40, 40, 40));
+
+    int baseline = 0;
+    Size textSize = getTextSize(constants::loadingMessage, FONT_HERSHEY_SIMPLEX, 0.75, 2, &baseline);
+    Point textOrg((N2 - textSize.width) / 2, (N1 + textSize.height) / 2);
+    putText(targetROI, constants::loadingMessage, textOrg, FONT_HERSHEY_SIMPLEX, 0.75, Scalar(255, 255, 255), 2);
 }
 
 // Fill the grid with images at specified positions
@@ -86,38 +146,24 @@ void ImageFlow::fillGrid(Mat& grid, const Mat& img, int position) {
     img.copyTo(targetROI);
 }
 
-// Get file paths for images and masks
-std::pair<std::vector<string>, std::vector<string>> ImageFlow::getFiles(const string& path, const string& mask_path) {
-    vector<string> files;
-    vector<string> mask_files;
-    try {
-        // Check if the path exists
-        if (!filesystem::exists(path)) {
-            cerr << "ERROR: Path does not exist. Correct it in constants.h file" << endl;
-            return std::make_pair(files, mask_files);
-        }
-        // Iterate through the directory and add file paths to the list
-        for (const auto& entry : filesystem::directory_iterator(path)) {
-            if (entry.is_regular_file())
-                files.push_back(entry.path().string());
-        }
-
-        // Sort files based on extracted numbers
-        sort(files.begin(), files.end(), [this](const string& a, const string& b) {
-            return extractNumber(a) < extractNumber(b);
-        });
-
-        // Generate corresponding mask file paths
-        for (const auto& entry : files) {
-            std::string file_mask_path = mask_path + "/" + entry.substr(entry.find_last_of("/\\") + 1);
-            mask_files.push_back(file_mask_path);
-        }
+// Apply the files added to or removed from the data directory
+void ImageFlow::refreshFiles() {
+    if (!directory || !directory->poll()) {
+        return;
+    }
+    files = directory->files();
+    mask_files = getMaskFiles(files);
+    cout << "Data directory changed, " << files.size() << " images" << endl;
+}
 
-    } catch (const filesystem::filesystem_error& e) {
-        cerr << e.what() << endl;
-        return std::make_pair(files, mask_files);
+// Generate the mask file paths corresponding to the image files
+std::vector<string> ImageFlow::getMaskFiles(const std::vector<string>& files) const {
+    vector<string> mask_files;
+    for (const auto& entry : files) {
+        std::string file_mask_path = maskPath + "/" + entry.substr(entry.find_last_of("/\\") + 1);
+        mask_files.push_back(file_mask_path);
     }
-    return std::make_pair(files, mask_files);
+    return mask_files;
 }
 
 // Apply mask to an image
@@ -163,8 +209,7 @@ cv::Mat ImageFlow::applyOpticalFlow() {
     // Apply mask to the first image
     Mat output = applyMask(mask_img, img);
 
-    // Load the corresponding mask image
-    mask_img = imread(mask_files[selectedImage - 1], IMREAD_GRAYSCALE);
+    // The mask is decoded together with the image
     if (mask_img.empty()) {
         cerr << "Failed to load mask." << endl;
         return output;
@@ -317,16 +362,24 @@ cv::Mat ImageFlow::createWelcomeScreen(const std::vector<std::string>& messages,
 void ImageFlow::run() {
     // Create a window for display
     namedWindow("Display", WINDOW_AUTOSIZE);
-    imshow("Display", grid);
+    showGrid();
 
     while (true) {
         int number = -1;
-        char key = waitKey(0); // Wait for a key press
+        char key = waitForKey(); // Wait for a key press
         if (key == 'q') break; // Quit on 'q' key press
         else if (key == 13 || key == 10) {
             // Display images on Enter key press
             displayImages(selectedImage);
         }
+        // Show the stage timings on 'h' and save them as a trace on 't'
+        else if (key == 'h') {
+            Profiler::instance().toggleOverlay();
+            showGrid();
+        }
+        else if (key == 't') {
+            Profiler::instance().writeTrace(constants::traceFile);
+        }
         else if (key >= '0' && key <= '9') {
             // Process digit key presses to construct a number
             string numberStr = "";
@@ -334,7 +387,7 @@ void ImageFlow::run() {
 
             // Continue to capture digits until Enter is pressed
             while(true) {
-                key = waitKey(0);
+                key = waitForKey();
                 if (key == 13 || key == 10) { // If Enter is pressed, break
                     number = atoi(numberStr.c_str());
                     selectedImage = number;
@@ -349,3 +402,15 @@ void ImageFlow::run() {
         }
     }
 }
+
+// Wait for a key press while showing the images that finish decoding
+char ImageFlow::waitForKey() {
+    while (true) {
+        int key = waitKey(constants::pollDelay);
+        if (key != -1) {
+            return key;
+        }
+        refreshFiles();
+        showPendingImages();
+    }
+}